@@ -0,0 +1,200 @@
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cfloat>
+#include <vector>
+
+// Continuous distance-dependent LOD (CDLOD) quadtree over a TerrainChunks grid. Leaf nodes are
+// the chunks; a node at level l covers 2^l x 2^l leaves and is drawn with the same shared patch
+// mesh at a vertex stride of 2^l. Each level is used within a distance range of the camera
+// that doubles per level, and vertices near the end of a range morph onto the next coarser
+// level's grid, so neighbouring nodes meet without cracks and switching levels does not pop.
+class CdlodQuadtree
+{
+public:
+    // A node (or one quadrant of it) to draw
+    struct Selection
+    {
+        int firstX; // Grid coordinates of the node's first vertex
+        int firstZ;
+        int level;    // Vertex stride is 1 << level
+        int quadrant; // -1 for the whole node, otherwise 0-3 (x-major: top-left, top-right, bottom-left, bottom-right)
+    };
+
+    CdlodQuadtree() : gridWidth(0), gridHeight(0), gridSpacing(0.0f), gridOriginX(0.0f), gridOriginZ(0.0f)
+    {
+    }
+
+    // Rebuild the per-node height ranges from the chunks' ranges
+    void build(const TerrainChunks &chunks)
+    {
+        gridWidth = chunks.width();
+        gridHeight = chunks.height();
+        gridSpacing = chunks.spacing();
+        gridOriginX = chunks.originX();
+        gridOriginZ = chunks.originZ();
+
+        levels.clear();
+        if (chunks.empty())
+            return;
+
+        Level leaves;
+        leaves.countX = chunks.chunkCountX();
+        leaves.countZ = chunks.chunkCountZ();
+        leaves.heightRanges.resize(chunks.size());
+        for (size_t i = 0; i < chunks.size(); ++i)
+            leaves.heightRanges[i] = glm::vec2(chunks.chunk(i).minHeight, chunks.chunk(i).maxHeight);
+        levels.push_back(std::move(leaves));
+
+        // Each parent's range covers its (up to four) children, up to a single root
+        while (levels.back().countX > 1 || levels.back().countZ > 1)
+        {
+            const Level &children = levels.back();
+            Level parents;
+            parents.countX = (children.countX + 1) / 2;
+            parents.countZ = (children.countZ + 1) / 2;
+            parents.heightRanges.assign((size_t)parents.countX * parents.countZ, glm::vec2(FLT_MAX, -FLT_MAX));
+            for (int z = 0; z < children.countZ; ++z)
+            {
+                for (int x = 0; x < children.countX; ++x)
+                {
+                    const glm::vec2 &child = children.heightRanges[(size_t)z * children.countX + x];
+                    glm::vec2 &parent = parents.heightRanges[(size_t)(z / 2) * parents.countX + x / 2];
+                    parent.x = std::min(parent.x, child.x);
+                    parent.y = std::max(parent.y, child.y);
+                }
+            }
+            levels.push_back(std::move(parents));
+        }
+    }
+
+    int levelCount() const { return (int)levels.size(); }
+
+    // Set the distance ranges: level l is used up to leafRange * 2^l from the camera (the root
+    // always), and morphs over the last (1 - morphStartRatio) of its band
+    void setRanges(float leafRange, float morphStartRatio)
+    {
+        ranges.resize(levels.size());
+        morphRanges.resize(levels.size());
+
+        float previousRange = 0.0f;
+        for (size_t level = 0; level < levels.size(); ++level)
+        {
+            const bool root = (level + 1 == levels.size());
+            ranges[level] = root ? unlimitedRange : leafRange * (float)(1 << level);
+
+            // The root has no coarser level to morph into
+            float morphStart = previousRange + (ranges[level] - previousRange) * morphStartRatio;
+            morphRanges[level] = root ? glm::vec2(unlimitedRange, 2.0f * unlimitedRange) : glm::vec2(morphStart, ranges[level]);
+            previousRange = ranges[level];
+        }
+    }
+
+    // Distance band (start, end) over which vertices of `level` morph into the next level
+    glm::vec2 morphRange(int level) const { return morphRanges[level]; }
+
+    // Pick the nodes to draw for a camera at `cameraPos` (model space). Heights are scaled by heightScale.
+    void select(const glm::vec3 &cameraPos, float heightScale, std::vector<Selection> &selection) const
+    {
+        selection.clear();
+        if (levels.empty())
+            return;
+
+        const int top = (int)levels.size() - 1;
+        for (int z = 0; z < levels[top].countZ; ++z)
+        {
+            for (int x = 0; x < levels[top].countX; ++x)
+                selectNode(top, x, z, cameraPos, heightScale, selection);
+        }
+    }
+
+    // Model-space bounding box of a selection (the quadrant's area, with its node's height range)
+    void selectionBounds(const Selection &selection, float heightScale, glm::vec3 &boxMin, glm::vec3 &boxMax) const
+    {
+        const int nodeQuads = TerrainChunks::chunkQuads << selection.level;
+        nodeBounds(selection.level, selection.firstX / nodeQuads, selection.firstZ / nodeQuads, heightScale, boxMin, boxMax);
+        if (selection.quadrant < 0)
+            return;
+
+        const float halfSize = (nodeQuads / 2) * gridSpacing;
+        boxMin.x += (selection.quadrant & 1) * halfSize;
+        boxMin.z += (selection.quadrant >> 1) * halfSize;
+        boxMax.x = std::min(boxMax.x, boxMin.x + halfSize);
+        boxMax.z = std::min(boxMax.z, boxMin.z + halfSize);
+    }
+
+private:
+    struct Level
+    {
+        int countX;
+        int countZ;
+        std::vector<glm::vec2> heightRanges; // (min, max) unit-amplitude height per node
+    };
+
+    static constexpr float unlimitedRange = 1e30f;
+
+    int gridWidth;
+    int gridHeight;
+    float gridSpacing;
+    float gridOriginX;
+    float gridOriginZ;
+    std::vector<Level> levels;
+    std::vector<float> ranges;
+    std::vector<glm::vec2> morphRanges;
+
+    // Returns false if the node is out of its level's range, in which case the parent covers its area
+    bool selectNode(int level, int x, int z, const glm::vec3 &cameraPos, float heightScale, std::vector<Selection> &selection) const
+    {
+        const int nodeQuads = TerrainChunks::chunkQuads << level;
+        const int firstX = x * nodeQuads;
+        const int firstZ = z * nodeQuads;
+
+        if (!intersectsSphere(level, x, z, cameraPos, heightScale, ranges[level]))
+            return false;
+
+        if (level == 0 || !intersectsSphere(level, x, z, cameraPos, heightScale, ranges[level - 1]))
+        {
+            selection.push_back({firstX, firstZ, level, -1});
+            return true;
+        }
+
+        const Level &children = levels[level - 1];
+        for (int quadrant = 0; quadrant < 4; ++quadrant)
+        {
+            int childX = 2 * x + (quadrant & 1);
+            int childZ = 2 * z + (quadrant >> 1);
+            if (childX >= children.countX || childZ >= children.countZ)
+                continue; // Past the grid edge
+
+            if (!selectNode(level - 1, childX, childZ, cameraPos, heightScale, selection))
+                selection.push_back({firstX, firstZ, level, quadrant});
+        }
+        return true;
+    }
+
+    // Model-space bounding box of node (x, z) of a level, clipped to the grid
+    void nodeBounds(int level, int x, int z, float heightScale, glm::vec3 &boxMin, glm::vec3 &boxMax) const
+    {
+        const int nodeQuads = TerrainChunks::chunkQuads << level;
+        const int firstX = x * nodeQuads;
+        const int firstZ = z * nodeQuads;
+        const int lastX = std::min(firstX + nodeQuads, gridWidth - 1);
+        const int lastZ = std::min(firstZ + nodeQuads, gridHeight - 1);
+
+        const glm::vec2 &heights = levels[level].heightRanges[(size_t)z * levels[level].countX + x];
+        float minY = std::min(heights.x * heightScale, heights.y * heightScale);
+        float maxY = std::max(heights.x * heightScale, heights.y * heightScale);
+
+        boxMin = glm::vec3(gridOriginX + firstX * gridSpacing, minY, gridOriginZ + firstZ * gridSpacing);
+        boxMax = glm::vec3(gridOriginX + lastX * gridSpacing, maxY, gridOriginZ + lastZ * gridSpacing);
+    }
+
+    // Whether the node's bounding box comes within `range` of the camera
+    bool intersectsSphere(int level, int x, int z, const glm::vec3 &cameraPos, float heightScale, float range) const
+    {
+        glm::vec3 boxMin, boxMax;
+        nodeBounds(level, x, z, heightScale, boxMin, boxMax);
+        glm::vec3 nearest = glm::clamp(cameraPos, boxMin, boxMax);
+        glm::vec3 offset = cameraPos - nearest;
+        return glm::dot(offset, offset) <= range * range;
+    }
+};
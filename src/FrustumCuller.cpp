@@ -0,0 +1,152 @@
+#include <glm/glm.hpp>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define FRUSTUM_SIMD_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FRUSTUM_SIMD_SSE2 1
+#endif
+
+// View-frustum culling of axis-aligned boxes. Boxes are stored structure-of-arrays so the
+// plane tests run 8 (AVX2) or 4 (SSE2) boxes at a time: for each plane only the box corner
+// furthest along the plane normal (the "positive vertex") is tested, and since the normal is
+// the same for every box, picking that corner is a choice of array rather than a per-box branch.
+class FrustumCuller
+{
+public:
+    FrustumCuller()
+    {
+        // Until setFrustum() is called every box is visible
+        for (glm::vec4 &plane : planes)
+            plane = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    }
+
+    void clear()
+    {
+        for (std::vector<float> &bound : bounds)
+            bound.clear();
+    }
+
+    void reserve(size_t count)
+    {
+        for (std::vector<float> &bound : bounds)
+            bound.reserve(count);
+    }
+
+    // Add a box; its index is the number of boxes added before it
+    void add(const glm::vec3 &boxMin, const glm::vec3 &boxMax)
+    {
+        bounds[MinX].push_back(boxMin.x);
+        bounds[MinY].push_back(boxMin.y);
+        bounds[MinZ].push_back(boxMin.z);
+        bounds[MaxX].push_back(boxMax.x);
+        bounds[MaxY].push_back(boxMax.y);
+        bounds[MaxZ].push_back(boxMax.z);
+    }
+
+    size_t size() const { return bounds[MinX].size(); }
+
+    // Extract the six frustum planes (in the boxes' space) from a view-projection matrix
+    void setFrustum(const glm::mat4 &viewProjection)
+    {
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            for (int side = 0; side < 2; ++side)
+            {
+                glm::vec4 &plane = planes[axis * 2 + side];
+                const float sign = side == 0 ? 1.0f : -1.0f;
+                for (int i = 0; i < 4; ++i)
+                    plane[i] = viewProjection[i][3] + sign * viewProjection[i][axis];
+            }
+        }
+    }
+
+    // Append the indices of the boxes inside or crossing the frustum, in order
+    void cull(std::vector<int> &visible) const
+    {
+        const int count = (int)size();
+        const float *minX = bounds[MinX].data();
+        const float *minY = bounds[MinY].data();
+        const float *minZ = bounds[MinZ].data();
+        const float *maxX = bounds[MaxX].data();
+        const float *maxY = bounds[MaxY].data();
+        const float *maxZ = bounds[MaxZ].data();
+
+        // Positive-vertex arrays per plane
+        const float *cornerX[6], *cornerY[6], *cornerZ[6];
+        for (int p = 0; p < 6; ++p)
+        {
+            cornerX[p] = planes[p].x >= 0.0f ? maxX : minX;
+            cornerY[p] = planes[p].y >= 0.0f ? maxY : minY;
+            cornerZ[p] = planes[p].z >= 0.0f ? maxZ : minZ;
+        }
+
+        int i = 0;
+
+#if defined(FRUSTUM_SIMD_AVX2)
+        for (; i + 8 <= count; i += 8)
+        {
+            __m256 outside = _mm256_setzero_ps();
+            for (int p = 0; p < 6; ++p)
+            {
+                // Separate multiply and add: FMA is a separate extension from AVX2 (-mfma)
+                __m256 distance = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(planes[p].x), _mm256_loadu_ps(cornerX[p] + i)), _mm256_set1_ps(planes[p].w));
+                distance = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(planes[p].y), _mm256_loadu_ps(cornerY[p] + i)), distance);
+                distance = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(planes[p].z), _mm256_loadu_ps(cornerZ[p] + i)), distance);
+                outside = _mm256_or_ps(outside, _mm256_cmp_ps(distance, _mm256_setzero_ps(), _CMP_LT_OQ));
+            }
+            appendVisible(~_mm256_movemask_ps(outside) & 0xff, i, visible);
+        }
+#elif defined(FRUSTUM_SIMD_SSE2)
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128 outside = _mm_setzero_ps();
+            for (int p = 0; p < 6; ++p)
+            {
+                __m128 distance = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(planes[p].x), _mm_loadu_ps(cornerX[p] + i)), _mm_set1_ps(planes[p].w));
+                distance = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(planes[p].y), _mm_loadu_ps(cornerY[p] + i)), distance);
+                distance = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(planes[p].z), _mm_loadu_ps(cornerZ[p] + i)), distance);
+                outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, _mm_setzero_ps()));
+            }
+            appendVisible(~_mm_movemask_ps(outside) & 0xf, i, visible);
+        }
+#endif
+
+        // Scalar tail (and every box when no SIMD path is compiled in)
+        for (; i < count; ++i)
+        {
+            bool outside = false;
+            for (int p = 0; p < 6 && !outside; ++p)
+                outside = planes[p].x * cornerX[p][i] + planes[p].y * cornerY[p][i] + planes[p].z * cornerZ[p][i] + planes[p].w < 0.0f;
+            if (!outside)
+                visible.push_back(i);
+        }
+    }
+
+private:
+    enum Bound
+    {
+        MinX,
+        MinY,
+        MinZ,
+        MaxX,
+        MaxY,
+        MaxZ,
+        BoundCount
+    };
+
+    std::vector<float> bounds[BoundCount];
+    glm::vec4 planes[6]; // (normal, distance): left, right, bottom, top, near, far
+
+    // Bit n of `mask` set means box first + n is visible
+    static void appendVisible(int mask, int first, std::vector<int> &visible)
+    {
+        for (int lane = 0; mask != 0; ++lane, mask >>= 1)
+        {
+            if (mask & 1)
+                visible.push_back(first + lane);
+        }
+    }
+};
@@ -0,0 +1,270 @@
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// Geometry clipmap: nested square rings of terrain centred on a point, each level twice as
+// coarse as the one inside it. Every level keeps its heights in a textureSize x textureSize
+// window addressed toroidally (global sample (x, z) lives at texel (x mod size, z mod size)),
+// so when the centre moves only the newly exposed L-shaped strips are generated, and only the
+// texel regions they cover need uploading. Heights are generated straight from the noise at
+// unit amplitude, so the terrain has no edge.
+class GeometryClipmap
+{
+public:
+    static constexpr int ringQuads = 128;                          // Quads along a level side
+    static constexpr int ringVertices = ringQuads + 1;             // Vertices along a level side (fits 16-bit indices)
+    static constexpr int holeQuads = ringQuads / 2;                // Quads the next finer level covers, in this level's units
+    static constexpr int apron = 1;                                // Extra samples kept past each side for normals
+    static constexpr int textureSize = ringVertices + 2 * apron;   // Texels along a level's height window
+    static constexpr int transitionWidth = ringQuads / 10;         // Vertices over which a level morphs into the next coarser one
+
+    // Texels of one level that changed since the last upload
+    struct Region
+    {
+        int level;
+        int x; // First texel
+        int z;
+        int width;
+        int height;
+    };
+
+    GeometryClipmap(const PerlinNoise &noise, ThreadPool &pool, int levelCount = 8)
+        : perlin(noise), threadPool(pool), baseSpacing(0.0f), octaveCount(0), persistence(0.0f), lacunarity(0.0f),
+          baseFrequency(0.0f), levels(levelCount), generatedSamples(0)
+    {
+    }
+
+    // Set the finest level's sample spacing and the noise parameters. Any change invalidates every level.
+    void configure(float spacing, int octaves, float octavePersistence, float octaveLacunarity, float frequency)
+    {
+        if (spacing == baseSpacing && octaves == octaveCount && octavePersistence == persistence &&
+            octaveLacunarity == lacunarity && frequency == baseFrequency)
+            return;
+
+        baseSpacing = spacing;
+        octaveCount = octaves;
+        persistence = octavePersistence;
+        lacunarity = octaveLacunarity;
+        baseFrequency = frequency;
+        octaveTable = PerlinNoise::makeOctaves(octaves, octavePersistence, octaveLacunarity, frequency, 1.0f);
+        for (Level &level : levels)
+            level.valid = false;
+    }
+
+    // Recentre every level on the model-space point (centerX, centerZ), generating the samples
+    // that enter each level's window. The work is proportional to how far the centre moved.
+    void update(float centerX, float centerZ)
+    {
+        generatedSamples = 0;
+        if (baseSpacing <= 0.0f)
+            return;
+
+        // Cells of the finer levels derive from the finest one, so the nesting is exact at every level
+        const glm::ivec2 finestCell((int)std::floor(centerX / baseSpacing), (int)std::floor(centerZ / baseSpacing));
+
+        std::vector<Run> runs;
+        for (int index = 0; index < (int)levels.size(); ++index)
+        {
+            Level &level = levels[index];
+            level.cell = glm::ivec2(finestCell.x >> index, finestCell.y >> index);
+
+            // Level origins sit on even samples, so a level's vertices line up with every other vertex
+            // of the level inside it and its odd vertices can morph onto the coarser grid
+            glm::ivec2 origin(2 * (level.cell.x >> 1) - ringQuads / 2, 2 * (level.cell.y >> 1) - ringQuads / 2);
+            glm::ivec2 first(origin.x - apron, origin.y - apron);
+            glm::ivec2 previous(level.origin.x - apron, level.origin.y - apron);
+
+            if (!level.valid || std::abs(first.x - previous.x) >= textureSize || std::abs(first.y - previous.y) >= textureSize)
+            {
+                level.heights.resize((size_t)textureSize * textureSize);
+                for (int z = first.y; z < first.y + textureSize; ++z)
+                    runs.push_back({index, z, first.x, textureSize});
+                pending.push_back({index, 0, 0, textureSize, textureSize});
+            }
+            else if (origin != level.origin)
+            {
+                // Rows entering the window, across its full width
+                int firstNewRow = (first.y > previous.y) ? previous.y + textureSize : first.y;
+                int newRows = std::abs(first.y - previous.y);
+                for (int z = firstNewRow; z < firstNewRow + newRows; ++z)
+                    runs.push_back({index, z, first.x, textureSize});
+                addPendingRows(index, firstNewRow, newRows);
+
+                // Columns entering the window, over the rows that were already there
+                int firstNewColumn = (first.x > previous.x) ? previous.x + textureSize : first.x;
+                int newColumns = std::abs(first.x - previous.x);
+                if (newColumns > 0)
+                {
+                    int firstOldRow = std::max(first.y, previous.y);
+                    int lastOldRow = std::min(first.y, previous.y) + textureSize;
+                    for (int z = firstOldRow; z < lastOldRow; ++z)
+                        runs.push_back({index, z, firstNewColumn, newColumns});
+                    addPendingColumns(index, firstNewColumn, newColumns);
+                }
+            }
+
+            level.origin = origin;
+            level.valid = true;
+        }
+
+        threadPool.parallelFor(0, (int)runs.size(), threadPool.grainFor((int)runs.size()), [&](int first, int last) {
+            for (int i = first; i < last; ++i)
+                generateRun(runs[i]);
+        });
+        for (const Run &run : runs)
+            generatedSamples += run.count;
+    }
+
+    int levelCount() const { return (int)levels.size(); }
+
+    // Distance between neighbouring samples of a level; every level doubles the previous one
+    float levelSpacing(int level) const { return std::ldexp(baseSpacing, level); }
+
+    // Global sample index of a level's vertex (0, 0)
+    glm::ivec2 levelOrigin(int level) const { return levels[level].origin; }
+
+    // Texel holding a level's vertex (0, 0)
+    glm::ivec2 levelTexel(int level) const
+    {
+        return glm::ivec2(wrap(levels[level].origin.x), wrap(levels[level].origin.y));
+    }
+
+    // Which ring variant leaves the right hole for the next finer level (see buildIndices)
+    int ringVariant(int level) const { return (levels[level].cell.x & 1) | ((levels[level].cell.y & 1) << 1); }
+
+    // A level's textureSize x textureSize heights, in texel order
+    const float *levelHeights(int level) const { return levels[level].heights.data(); }
+
+    // Samples generated by the last update()
+    size_t lastGeneratedSamples() const { return generatedSamples; }
+
+    const std::vector<Region> &pendingRegions() const { return pending; }
+    void clearPendingRegions() { pending.clear(); }
+
+    // Build the 16-bit triangle-list index buffer shared by every level: vertex (x, z) has index
+    // x + z * ringVertices. It holds the full grid (drawn by the finest level) followed by the four
+    // rings whose hole starts holeQuads / 2 + (variant & 1, variant >> 1) quads in. With
+    // `optimizeVertexCache`, each part is reordered for the post-transform vertex cache.
+    static void buildIndices(std::vector<unsigned short> &indices, bool optimizeVertexCache = false)
+    {
+        indices.clear();
+        indices.reserve(indexOffset(5));
+        for (int variant = -1; variant < 4; ++variant)
+        {
+            const int holeX = holeQuads / 2 + (variant & 1);
+            const int holeZ = holeQuads / 2 + ((variant >> 1) & 1);
+            for (int z = 0; z < ringQuads; ++z)
+            {
+                for (int x = 0; x < ringQuads; ++x)
+                {
+                    bool inHole = x >= holeX && x < holeX + holeQuads && z >= holeZ && z < holeZ + holeQuads;
+                    if (variant >= 0 && inHole)
+                        continue;
+
+                    unsigned short topLeft = (unsigned short)(z * ringVertices + x);
+                    unsigned short topRight = topLeft + 1;
+                    unsigned short bottomLeft = (unsigned short)(topLeft + ringVertices);
+                    unsigned short bottomRight = bottomLeft + 1;
+
+                    indices.push_back(topLeft);
+                    indices.push_back(bottomLeft);
+                    indices.push_back(topRight);
+
+                    indices.push_back(topRight);
+                    indices.push_back(bottomLeft);
+                    indices.push_back(bottomRight);
+                }
+            }
+        }
+
+        if (!optimizeVertexCache)
+            return;
+        VertexCacheOptimizer optimizer;
+        for (int part = 0; part < 5; ++part)
+            optimizer.optimize(indices.data() + indexOffset(part), indexCount(part));
+    }
+
+    // Start of a part of buildIndices' buffer: 0 is the full grid, 1-4 are the ring variants 0-3
+    static size_t indexOffset(int part)
+    {
+        const size_t gridIndices = (size_t)ringQuads * ringQuads * 6;
+        const size_t ringIndices = gridIndices - (size_t)holeQuads * holeQuads * 6;
+        return part == 0 ? 0 : gridIndices + (size_t)(part - 1) * ringIndices;
+    }
+
+    static size_t indexCount(int part) { return indexOffset(part + 1) - indexOffset(part); }
+
+private:
+    struct Level
+    {
+        glm::ivec2 cell = glm::ivec2(0);   // Cell of this level containing the centre
+        glm::ivec2 origin = glm::ivec2(0); // Global sample index of vertex (0, 0)
+        bool valid = false;
+        std::vector<float> heights; // textureSize x textureSize, toroidal
+    };
+
+    // A horizontal run of samples of one level to generate
+    struct Run
+    {
+        int level;
+        int z;
+        int firstX;
+        int count;
+    };
+
+    const PerlinNoise &perlin;
+    ThreadPool &threadPool;
+    float baseSpacing;
+    int octaveCount;
+    float persistence;
+    float lacunarity;
+    float baseFrequency;
+    PerlinNoise::Octaves octaveTable;
+    std::vector<Level> levels;
+    std::vector<Region> pending;
+    size_t generatedSamples;
+
+    static int wrap(int index)
+    {
+        int texel = index % textureSize;
+        return texel < 0 ? texel + textureSize : texel;
+    }
+
+    // Sample (x, z) of level l is the noise at (x, z) * spacing * 2^l, which is exactly the same
+    // position as sample (2x, 2z) of level l - 1, so coincident vertices get identical heights
+    void generateRun(const Run &run)
+    {
+        Level &level = levels[run.level];
+        const float spacing = levelSpacing(run.level);
+        float *row = level.heights.data() + (size_t)wrap(run.z) * textureSize;
+
+        // Split where the run wraps around the texture
+        int texel = wrap(run.firstX);
+        int head = std::min(run.count, textureSize - texel);
+        perlin.fbmRow(0.0f, spacing, run.z * spacing, octaveTable, row + texel, head, run.firstX);
+        if (head < run.count)
+            perlin.fbmRow(0.0f, spacing, run.z * spacing, octaveTable, row, run.count - head, run.firstX + head);
+    }
+
+    // Queue uploads of whole texel rows / columns, split where they wrap
+    void addPendingRows(int level, int firstRow, int count)
+    {
+        int texel = wrap(firstRow);
+        int head = std::min(count, textureSize - texel);
+        if (head > 0)
+            pending.push_back({level, 0, texel, textureSize, head});
+        if (head < count)
+            pending.push_back({level, 0, 0, textureSize, count - head});
+    }
+
+    void addPendingColumns(int level, int firstColumn, int count)
+    {
+        int texel = wrap(firstColumn);
+        int head = std::min(count, textureSize - texel);
+        if (head > 0)
+            pending.push_back({level, texel, 0, head, textureSize});
+        if (head < count)
+            pending.push_back({level, 0, 0, count - head, textureSize});
+    }
+};
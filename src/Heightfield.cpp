@@ -0,0 +1,89 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// Regular grid of terrain heights stored row by row. Sample (x, z) lies at
+// (originX + x * spacing, originZ + z * spacing) in model space; positions, texture
+// coordinates and normals are all derived from the grid, so only the height is stored.
+class Heightfield
+{
+public:
+    Heightfield() : columnCount(0), rowCount(0), gridSpacing(0.0f), gridOriginX(0.0f), gridOriginZ(0.0f)
+    {
+    }
+
+    // Set the grid layout. Keeps the existing allocation when the sample count is unchanged;
+    // height values are left unspecified.
+    void resize(int width, int height, float spacing, float originX, float originZ)
+    {
+        columnCount = width;
+        rowCount = height;
+        gridSpacing = spacing;
+        gridOriginX = originX;
+        gridOriginZ = originZ;
+        heights.resize((size_t)width * height);
+    }
+
+    int width() const { return columnCount; }
+    int height() const { return rowCount; }
+    float spacing() const { return gridSpacing; }
+    float originX() const { return gridOriginX; }
+    float originZ() const { return gridOriginZ; }
+    bool empty() const { return heights.empty(); }
+    size_t sampleCount() const { return heights.size(); }
+
+    // Model-space coordinates of a grid column / row
+    float worldX(int x) const { return gridOriginX + x * gridSpacing; }
+    float worldZ(int z) const { return gridOriginZ + z * gridSpacing; }
+
+    float at(int x, int z) const { return heights[(size_t)z * columnCount + x]; }
+    float &at(int x, int z) { return heights[(size_t)z * columnCount + x]; }
+
+    // The width() contiguous heights of row z
+    const float *row(int z) const { return heights.data() + (size_t)z * columnCount; }
+    float *row(int z) { return heights.data() + (size_t)z * columnCount; }
+
+    const std::vector<float> &data() const { return heights; }
+
+    // Bilinearly interpolated height at a model-space position, clamped to the grid edges. A grid
+    // one sample wide (or high) is constant along that axis; an empty one is 0 everywhere.
+    float sample(float worldPosX, float worldPosZ) const
+    {
+        if (heights.empty())
+            return 0.0f;
+
+        float gx = std::min(std::max((worldPosX - gridOriginX) / gridSpacing, 0.0f), (float)(columnCount - 1));
+        float gz = std::min(std::max((worldPosZ - gridOriginZ) / gridSpacing, 0.0f), (float)(rowCount - 1));
+
+        int x0 = std::max(std::min((int)gx, columnCount - 2), 0);
+        int z0 = std::max(std::min((int)gz, rowCount - 2), 0);
+        const int nextX = columnCount > 1 ? 1 : 0;
+        const int nextZ = rowCount > 1 ? columnCount : 0;
+        float tx = gx - x0;
+        float tz = gz - z0;
+
+        const float *top = row(z0) + x0;
+        const float *bottom = top + nextZ;
+        float upper = top[0] + (top[nextX] - top[0]) * tx;
+        float lower = bottom[0] + (bottom[nextX] - bottom[0]) * tx;
+        return upper + (lower - upper) * tz;
+    }
+
+    void swap(Heightfield &other)
+    {
+        std::swap(columnCount, other.columnCount);
+        std::swap(rowCount, other.rowCount);
+        std::swap(gridSpacing, other.gridSpacing);
+        std::swap(gridOriginX, other.gridOriginX);
+        std::swap(gridOriginZ, other.gridOriginZ);
+        heights.swap(other.heights);
+    }
+
+private:
+    int columnCount;
+    int rowCount;
+    float gridSpacing;
+    float gridOriginX;
+    float gridOriginZ;
+    std::vector<float> heights;
+};
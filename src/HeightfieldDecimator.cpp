@@ -0,0 +1,429 @@
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include <vector>
+
+// Quadric-error-metric (QEM) simplification of a patch of a Heightfield. The patch starts as
+// the regular grid (two triangles per quad) and is reduced by half-edge collapses: an interior
+// vertex is merged into a neighbour, cheapest summed plane quadric first. A collapse is only
+// made if the new triangles stay the same way round seen from above and no grid sample under
+// them is further than maxError (vertically) from the simplified surface. Border vertices never
+// move or disappear, so patches simplified separately still meet along their edges.
+//
+// Vertices stay on their grid samples, so the result is an index list into the patch's
+// unchanged vertices.
+class HeightfieldDecimator
+{
+public:
+    // Simplify the quadsX x quadsZ quads whose vertex (0, 0) is sample (firstX, firstZ) of
+    // `heights`. Vertex (x, z) gets index x + z * indexStride in the output triangle list, which
+    // is wound like the full grid's (top-left, bottom-left, top-right).
+    void decimate(const Heightfield &heights, int firstX, int firstZ, int quadsX, int quadsZ, float maxError, int indexStride,
+                  std::vector<unsigned short> &indices)
+    {
+        field = &heights;
+        sampleX = firstX;
+        sampleZ = firstZ;
+        columns = quadsX + 1;
+        rows = quadsZ + 1;
+        errorBound = maxError;
+        buildGrid();
+
+        std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> queue;
+        for (int vertex = 0; vertex < columns * rows; ++vertex)
+        {
+            collectNeighbours(vertex, around);
+            for (int other : around)
+                pushCollapse(vertex, other, queue);
+        }
+
+        while (!queue.empty())
+        {
+            Collapse collapse = queue.top();
+            queue.pop();
+            if (removed[collapse.from] || removed[collapse.to])
+                continue;
+            // Quadrics only grow, so a collapse queued before either vertex changed costs at least
+            // as much now: requeue it at its current cost instead of requeueing every edge around
+            // a vertex each time it changes
+            if (versions[collapse.from] != collapse.fromVersion || versions[collapse.to] != collapse.toVersion)
+            {
+                pushCollapse(collapse.from, collapse.to, queue);
+                continue;
+            }
+            if (!canCollapse(collapse.from, collapse.to))
+            {
+                retries[collapse.from].push_back({collapse.from, collapse.to});
+                retries[collapse.to].push_back({collapse.from, collapse.to});
+                continue;
+            }
+
+            // Edges to the vertices only `from` was joined to are new
+            collectNeighbours(collapse.from, fromNeighbours);
+            collectNeighbours(collapse.to, toNeighbours);
+            applyCollapse(collapse.from, collapse.to);
+            for (int other : fromNeighbours)
+            {
+                if (other == collapse.to || std::find(toNeighbours.begin(), toNeighbours.end(), other) != toNeighbours.end())
+                    continue;
+                pushCollapse(collapse.to, other, queue);
+                pushCollapse(other, collapse.to, queue);
+            }
+            for (const std::pair<int, int> &retry : retries[collapse.to])
+            {
+                if (!removed[retry.first] && !removed[retry.second])
+                    pushCollapse(retry.first, retry.second, queue);
+            }
+            retries[collapse.to].clear();
+            retries[collapse.from].clear();
+        }
+
+        indices.clear();
+        for (size_t t = 0; t < triangles.size(); ++t)
+        {
+            if (!triangleAlive[t])
+                continue;
+            for (int corner = 0; corner < 3; ++corner)
+            {
+                int vertex = triangles[t].v[corner];
+                indices.push_back((unsigned short)(vertex % columns + (vertex / columns) * indexStride));
+            }
+        }
+    }
+
+private:
+    struct Triangle
+    {
+        int v[3];
+    };
+
+    // Symmetric 4x4 sum of plane quadrics (upper triangle, row-major)
+    struct Quadric
+    {
+        double q[10] = {};
+
+        void addPlane(double a, double b, double c, double d, double weight)
+        {
+            const double p[4] = {a, b, c, d};
+            int k = 0;
+            for (int i = 0; i < 4; ++i)
+                for (int j = i; j < 4; ++j)
+                    q[k++] += weight * p[i] * p[j];
+        }
+
+        void add(const Quadric &other)
+        {
+            for (int k = 0; k < 10; ++k)
+                q[k] += other.q[k];
+        }
+
+        // Sum of squared (weighted) plane distances of point (x, y, z)
+        double evaluate(double x, double y, double z) const
+        {
+            return q[0] * x * x + 2 * q[1] * x * y + 2 * q[2] * x * z + 2 * q[3] * x + q[4] * y * y + 2 * q[5] * y * z + 2 * q[6] * y +
+                   q[7] * z * z + 2 * q[8] * z + q[9];
+        }
+    };
+
+    struct Collapse
+    {
+        double cost;
+        int from;
+        int to;
+        int fromVersion;
+        int toVersion;
+
+        bool operator>(const Collapse &other) const { return cost > other.cost; }
+    };
+
+    const Heightfield *field = nullptr;
+    int sampleX = 0;
+    int sampleZ = 0;
+    int columns = 0;
+    int rows = 0;
+    float errorBound = 0.0f;
+
+    std::vector<Triangle> triangles;
+    std::vector<bool> triangleAlive;
+    std::vector<std::vector<int>> vertexTriangles; // Live triangles around each vertex
+    std::vector<Quadric> quadrics;
+    std::vector<bool> removed;
+    std::vector<int> versions; // Bumped when a vertex's quadric grows, marking the collapses queued with the old one stale
+    std::vector<std::vector<std::pair<int, int>>> retries; // Refused collapses (from, to), retried when either vertex changes
+    std::vector<int> around;
+    std::vector<int> fromNeighbours;
+    std::vector<int> toNeighbours;
+    std::vector<Triangle> moved;
+
+    int vertexX(int vertex) const { return vertex % columns; }
+    int vertexZ(int vertex) const { return vertex / columns; }
+    float height(int x, int z) const { return field->at(sampleX + x, sampleZ + z); }
+    float vertexHeight(int vertex) const { return height(vertexX(vertex), vertexZ(vertex)); }
+
+    bool isBorder(int vertex) const
+    {
+        int x = vertexX(vertex), z = vertexZ(vertex);
+        return x == 0 || z == 0 || x == columns - 1 || z == rows - 1;
+    }
+
+    // Twice the signed area of triangle (a, b, c) seen from above; the grid's triangles are negative
+    long long orientation(int a, int b, int c) const
+    {
+        long long abX = vertexX(b) - vertexX(a), abZ = vertexZ(b) - vertexZ(a);
+        long long acX = vertexX(c) - vertexX(a), acZ = vertexZ(c) - vertexZ(a);
+        return abX * acZ - abZ * acX;
+    }
+
+    void buildGrid()
+    {
+        const int vertexCount = columns * rows;
+        triangles.clear();
+        vertexTriangles.assign(vertexCount, std::vector<int>());
+        quadrics.assign(vertexCount, Quadric());
+        removed.assign(vertexCount, false);
+        versions.assign(vertexCount, 0);
+        retries.assign(vertexCount, std::vector<std::pair<int, int>>());
+
+        for (int z = 0; z + 1 < rows; ++z)
+        {
+            for (int x = 0; x + 1 < columns; ++x)
+            {
+                int topLeft = z * columns + x;
+                int topRight = topLeft + 1;
+                int bottomLeft = topLeft + columns;
+                int bottomRight = bottomLeft + 1;
+                addTriangle(topLeft, bottomLeft, topRight);
+                addTriangle(topRight, bottomLeft, bottomRight);
+            }
+        }
+        triangleAlive.assign(triangles.size(), true);
+    }
+
+    void addTriangle(int a, int b, int c)
+    {
+        const int index = (int)triangles.size();
+        triangles.push_back({{a, b, c}});
+        for (int vertex : {a, b, c})
+            vertexTriangles[vertex].push_back(index);
+
+        // Plane through the triangle in (grid x, height, grid z), weighted by its area
+        const double spacing = field->spacing();
+        double p[3][3];
+        for (int corner = 0; corner < 3; ++corner)
+        {
+            int vertex = triangles[index].v[corner];
+            p[corner][0] = vertexX(vertex) * spacing;
+            p[corner][1] = vertexHeight(vertex);
+            p[corner][2] = vertexZ(vertex) * spacing;
+        }
+        double e1[3] = {p[1][0] - p[0][0], p[1][1] - p[0][1], p[1][2] - p[0][2]};
+        double e2[3] = {p[2][0] - p[0][0], p[2][1] - p[0][1], p[2][2] - p[0][2]};
+        double n[3] = {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0]};
+        double length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (length <= 0.0)
+            return;
+        double nx = n[0] / length, ny = n[1] / length, nz = n[2] / length;
+        double d = -(nx * p[0][0] + ny * p[0][1] + nz * p[0][2]);
+        for (int vertex : {a, b, c})
+            quadrics[vertex].addPlane(nx, ny, nz, d, 0.5 * length);
+    }
+
+    // Vertices sharing a live triangle with `vertex`
+    void collectNeighbours(int vertex, std::vector<int> &neighbours) const
+    {
+        neighbours.clear();
+        for (int t : vertexTriangles[vertex])
+        {
+            for (int other : triangles[t].v)
+            {
+                if (other != vertex && std::find(neighbours.begin(), neighbours.end(), other) == neighbours.end())
+                    neighbours.push_back(other);
+            }
+        }
+    }
+
+    // Queue the collapse of `from` into `to` at its current cost, unless `from` is on the border
+    void pushCollapse(int from, int to, std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> &queue) const
+    {
+        if (isBorder(from))
+            return;
+        const double spacing = field->spacing();
+        Quadric sum = quadrics[from];
+        sum.add(quadrics[to]);
+        double cost = sum.evaluate(vertexX(to) * spacing, vertexHeight(to), vertexZ(to) * spacing);
+        queue.push({cost, from, to, versions[from], versions[to]});
+    }
+
+    // Merging `from` into `to` must keep the mesh a height field (every surviving triangle around
+    // `from` keeps its orientation, the edge has exactly two opposite vertices) within the error bound
+    bool canCollapse(int from, int to)
+    {
+        int shared = 0;
+        moved.clear();
+        for (int t : vertexTriangles[from])
+        {
+            Triangle triangle = triangles[t];
+            bool hasTo = triangle.v[0] == to || triangle.v[1] == to || triangle.v[2] == to;
+            if (hasTo)
+            {
+                ++shared;
+                continue;
+            }
+            for (int &vertex : triangle.v)
+                if (vertex == from)
+                    vertex = to;
+            if (orientation(triangle.v[0], triangle.v[1], triangle.v[2]) >= 0)
+                return false;
+            moved.push_back(triangle);
+        }
+        if (shared != 2)
+            return false;
+
+        // The new triangles tile exactly the area the old fan around `from` covered, so only the
+        // samples under them can change error. The sample at `from` is the likeliest to fail and
+        // the cheapest to test, so it goes before everything else.
+        for (const Triangle &triangle : moved)
+        {
+            if (!samplesWithinErrorBound(triangle, vertexZ(from), vertexZ(from), vertexX(from)))
+                return false;
+        }
+
+        // Link condition: the only vertices adjacent to both are the two opposite the edge
+        collectNeighbours(from, fromNeighbours);
+        collectNeighbours(to, toNeighbours);
+        int common = 0;
+        for (int vertex : toNeighbours)
+            common += std::find(fromNeighbours.begin(), fromNeighbours.end(), vertex) != fromNeighbours.end();
+        if (common != 2)
+            return false;
+
+        // The fan's outer edges are unchanged and were checked when they were made; each edge out
+        // of `to` follows it in exactly one of the new triangles
+        for (const Triangle &triangle : moved)
+        {
+            int corner = triangle.v[0] == to ? 0 : triangle.v[1] == to ? 1 : 2;
+            if (!edgeWithinErrorBound(to, triangle.v[(corner + 1) % 3]))
+                return false;
+        }
+        for (const Triangle &triangle : moved)
+        {
+            const int az = vertexZ(triangle.v[0]), bz = vertexZ(triangle.v[1]), cz = vertexZ(triangle.v[2]);
+            if (!samplesWithinErrorBound(triangle, std::min({az, bz, cz}), std::max({az, bz, cz})))
+                return false;
+        }
+        return true;
+    }
+
+    // The triangle stays within errorBound of the original surface at the grid samples under it
+    // in rows [firstZ, lastZ] (only column onlyX if that is given). That surface is linear over
+    // each grid triangle, so together with the edge checks, where the triangle's edges cross the
+    // grid lines (x, z or x + z constant), this covers every point where the difference can peak.
+    bool samplesWithinErrorBound(const Triangle &triangle, int firstZ, int lastZ, int onlyX = -1) const
+    {
+        const int ax = vertexX(triangle.v[0]), az = vertexZ(triangle.v[0]);
+        const int bx = vertexX(triangle.v[1]), bz = vertexZ(triangle.v[1]);
+        const int cx = vertexX(triangle.v[2]), cz = vertexZ(triangle.v[2]);
+        const float ha = height(ax, az), hb = height(bx, bz), hc = height(cx, cz);
+        const long long area = orientation(triangle.v[0], triangle.v[1], triangle.v[2]);
+        const long long sign = area < 0 ? -1 : 1;
+
+        for (int z = firstZ; z <= lastZ; ++z)
+        {
+            // Barycentric weights as exact integer edge functions, each w = p + q * x along the
+            // row; the sample is inside (or on the border) while every sign * w >= 0
+            const long long pa = (long long)bx * (cz - z) - (long long)(bz - z) * cx, qa = bz - cz;
+            const long long pb = (long long)cx * (az - z) - (long long)(cz - z) * ax, qb = cz - az;
+            int firstX = onlyX >= 0 ? onlyX : std::min({ax, bx, cx});
+            int lastX = onlyX >= 0 ? onlyX : std::max({ax, bx, cx});
+            const long long p[3] = {sign * pa, sign * pb, sign * (area - pa - pb)};
+            const long long q[3] = {sign * qa, sign * qb, -sign * (qa + qb)};
+            for (int k = 0; k < 3; ++k)
+            {
+                if (q[k] > 0)
+                    firstX = (int)std::max<long long>(firstX, ceilDivide(-p[k], q[k]));
+                else if (q[k] < 0)
+                    lastX = (int)std::min<long long>(lastX, floorDivide(p[k], -q[k]));
+                else if (p[k] < 0)
+                    lastX = firstX - 1;
+            }
+
+            for (int x = firstX; x <= lastX; ++x)
+            {
+                long long wa = pa + qa * x;
+                long long wb = pb + qb * x;
+                long long wc = area - wa - wb;
+                float surface = (float)((wa * (double)ha + wb * (double)hb + wc * (double)hc) / area);
+                if (std::fabs(surface - height(x, z)) > errorBound)
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    static long long floorDivide(long long numerator, long long denominator)
+    {
+        long long quotient = numerator / denominator;
+        return quotient * denominator > numerator ? quotient - 1 : quotient;
+    }
+
+    static long long ceilDivide(long long numerator, long long denominator) { return -floorDivide(-numerator, denominator); }
+
+    bool edgeWithinErrorBound(int a, int b) const
+    {
+        const int ax = vertexX(a), az = vertexZ(a);
+        const int dx = vertexX(b) - ax, dz = vertexZ(b) - az;
+        const float ha = vertexHeight(a), hb = vertexHeight(b);
+        for (int crossings : {std::abs(dx), std::abs(dz), std::abs(dx + dz)})
+        {
+            for (int k = 1; k < crossings; ++k)
+            {
+                double t = (double)k / crossings;
+                if (std::fabs(ha + t * (hb - ha) - surfaceAt(ax + t * dx, az + t * dz)) > errorBound)
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    // The full-resolution grid's surface at a point of the patch
+    double surfaceAt(double x, double z) const
+    {
+        int cellX = std::min((int)x, columns - 2), cellZ = std::min((int)z, rows - 2);
+        double fx = x - cellX, fz = z - cellZ;
+        double topLeft = height(cellX, cellZ), topRight = height(cellX + 1, cellZ);
+        double bottomLeft = height(cellX, cellZ + 1), bottomRight = height(cellX + 1, cellZ + 1);
+        if (fx + fz <= 1.0)
+            return topLeft + (topRight - topLeft) * fx + (bottomLeft - topLeft) * fz;
+        return bottomRight + (bottomLeft - bottomRight) * (1.0 - fx) + (topRight - bottomRight) * (1.0 - fz);
+    }
+
+    void applyCollapse(int from, int to)
+    {
+        for (int t : vertexTriangles[from])
+        {
+            Triangle &triangle = triangles[t];
+            if (triangle.v[0] == to || triangle.v[1] == to || triangle.v[2] == to)
+            {
+                // The two triangles on the edge disappear
+                triangleAlive[t] = false;
+                for (int vertex : triangle.v)
+                {
+                    if (vertex == from)
+                        continue;
+                    std::vector<int> &fan = vertexTriangles[vertex];
+                    fan.erase(std::find(fan.begin(), fan.end(), t));
+                }
+                continue;
+            }
+            for (int &vertex : triangle.v)
+                if (vertex == from)
+                    vertex = to;
+            vertexTriangles[to].push_back(t);
+        }
+
+        vertexTriangles[from].clear();
+        removed[from] = true;
+        quadrics[to].add(quadrics[from]);
+        ++versions[to];
+    }
+};
@@ -0,0 +1,206 @@
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// Conservative occlusion culling for heightfield terrain with a screen-column horizon buffer.
+// The terrain is a height field, so everything below its surface is solid: the box spanning a
+// chunk's footprint from the lowest terrain height up to the chunk's own minimum height lies
+// inside the terrain and hides whatever is behind it (for a camera above the surface). Each
+// screen column keeps one interval of covered screen heights, built from such occluder boxes
+// front to back; a draw whose projected bounds fall inside the covered interval of every column
+// it touches is hidden.
+//
+// Front to back here means rings of Manhattan distance, in chunks, from the chunk holding the
+// camera: along any view ray that distance never decreases, so an occluder in a nearer ring can
+// never be behind a draw whose nearest chunk lies in a further ring.
+class HorizonCuller
+{
+public:
+    static constexpr int columns = 512; // Horizon buffer resolution across the screen
+
+    struct Occluder
+    {
+        glm::vec3 boxMin; // Must lie entirely inside the terrain
+        glm::vec3 boxMax;
+        int ring;         // Manhattan distance in chunks from the camera's chunk
+    };
+
+    struct Candidate
+    {
+        glm::vec3 boxMin; // Bounds of everything the draw renders
+        glm::vec3 boxMax;
+        int ring;         // Distance of the draw's nearest chunk
+    };
+
+    HorizonCuller() : lower(columns), upper(columns)
+    {
+    }
+
+    // Keep the candidates that are not hidden by occluders in nearer rings. `visible` maps the
+    // candidates back to the caller's draws and is filtered in place (order is kept).
+    void cull(const glm::mat4 &viewProjection, const std::vector<Occluder> &occluders, const std::vector<Candidate> &candidates,
+              std::vector<int> &visible)
+    {
+        transform = viewProjection;
+        std::fill(lower.begin(), lower.end(), 1.0f);
+        std::fill(upper.begin(), upper.end(), -1.0f); // Empty intervals
+
+        occluderOrder.resize(occluders.size());
+        for (size_t i = 0; i < occluders.size(); ++i)
+            occluderOrder[i] = (int)i;
+        std::sort(occluderOrder.begin(), occluderOrder.end(), [&](int a, int b) { return occluders[a].ring < occluders[b].ring; });
+
+        candidateOrder.resize(candidates.size());
+        for (size_t i = 0; i < candidates.size(); ++i)
+            candidateOrder[i] = (int)i;
+        std::sort(candidateOrder.begin(), candidateOrder.end(), [&](int a, int b) { return candidates[a].ring < candidates[b].ring; });
+
+        // Test each ring's candidates before adding that ring's occluders
+        hidden.assign(candidates.size(), false);
+        size_t nextOccluder = 0;
+        for (int index : candidateOrder)
+        {
+            const Candidate &candidate = candidates[index];
+            for (; nextOccluder < occluderOrder.size() && occluders[occluderOrder[nextOccluder]].ring < candidate.ring; ++nextOccluder)
+                addOccluder(occluders[occluderOrder[nextOccluder]]);
+            hidden[index] = isOccluded(candidate.boxMin, candidate.boxMax);
+        }
+
+        size_t kept = 0;
+        for (size_t i = 0; i < visible.size(); ++i)
+        {
+            if (!hidden[i])
+                visible[kept++] = visible[i];
+        }
+        visible.resize(kept);
+    }
+
+private:
+    glm::mat4 transform;
+    std::vector<float> lower; // Covered screen heights (NDC y) per column; empty when lower > upper
+    std::vector<float> upper;
+    std::vector<int> occluderOrder;
+    std::vector<int> candidateOrder;
+    std::vector<bool> hidden;
+
+    // Project the 8 corners of a box to NDC x/y; false if any is not in front of the camera
+    bool projectBox(const glm::vec3 &boxMin, const glm::vec3 &boxMax, glm::vec2 corners[8]) const
+    {
+        for (int i = 0; i < 8; ++i)
+        {
+            glm::vec4 corner((i & 1) ? boxMax.x : boxMin.x, (i & 2) ? boxMax.y : boxMin.y, (i & 4) ? boxMax.z : boxMin.z, 1.0f);
+            glm::vec4 clip = transform * corner;
+            if (clip.w <= 1e-5f)
+                return false;
+            corners[i] = glm::vec2(clip.x / clip.w, clip.y / clip.w);
+        }
+        return true;
+    }
+
+    static float columnLeft(int column) { return -1.0f + 2.0f * column / columns; }
+
+    bool isOccluded(const glm::vec3 &boxMin, const glm::vec3 &boxMax) const
+    {
+        glm::vec2 corners[8];
+        if (!projectBox(boxMin, boxMax, corners))
+            return false;
+
+        glm::vec2 low = corners[0], high = corners[0];
+        for (const glm::vec2 &corner : corners)
+        {
+            low = glm::vec2(std::min(low.x, corner.x), std::min(low.y, corner.y));
+            high = glm::vec2(std::max(high.x, corner.x), std::max(high.y, corner.y));
+        }
+        if (high.x < -1.0f || low.x > 1.0f || high.y < -1.0f || low.y > 1.0f)
+            return false; // Off screen; left to the frustum test
+
+        // Only the on-screen part has to be covered
+        low.y = std::max(low.y, -1.0f);
+        high.y = std::min(high.y, 1.0f);
+        int first = std::max(0, (int)((low.x + 1.0f) * 0.5f * columns));
+        int last = std::min(columns - 1, (int)((high.x + 1.0f) * 0.5f * columns));
+        for (int column = first; column <= last; ++column)
+        {
+            if (lower[column] > low.y || upper[column] < high.y)
+                return false;
+        }
+        return true;
+    }
+
+    void addOccluder(const Occluder &occluder)
+    {
+        glm::vec2 corners[8];
+        if (occluder.boxMax.y <= occluder.boxMin.y || !projectBox(occluder.boxMin, occluder.boxMax, corners))
+            return;
+
+        // The box projects to the convex hull of its corners (monotone chain, counter-clockwise)
+        std::sort(corners, corners + 8, [](const glm::vec2 &a, const glm::vec2 &b) { return a.x < b.x || (a.x == b.x && a.y < b.y); });
+        glm::vec2 hull[16];
+        int size = 0;
+        for (int pass = 0; pass < 2; ++pass)
+        {
+            const int start = size;
+            for (int k = 0; k < 8; ++k)
+            {
+                const glm::vec2 &point = corners[pass == 0 ? k : 7 - k];
+                while (size >= start + 2 && cross(hull[size - 2], hull[size - 1], point) <= 0.0f)
+                    --size;
+                hull[size++] = point;
+            }
+            --size; // The last point starts the other chain
+        }
+        if (size < 3)
+            return;
+
+        const float hullLeft = corners[0].x;
+        const float hullRight = corners[7].x;
+        int first = std::max(0, (int)std::ceil((hullLeft + 1.0f) * 0.5f * columns));
+        int last = std::min(columns - 1, (int)std::floor((hullRight + 1.0f) * 0.5f * columns) - 1);
+        for (int column = first; column <= last; ++column)
+        {
+            // The hull is convex, so whatever it covers at both column edges it covers in between
+            float leftLow, leftHigh, rightLow, rightHigh;
+            hullSpan(hull, size, columnLeft(column), leftLow, leftHigh);
+            hullSpan(hull, size, columnLeft(column + 1), rightLow, rightHigh);
+            float coveredLow = std::max(leftLow, rightLow);
+            float coveredHigh = std::min(leftHigh, rightHigh);
+            if (coveredLow >= coveredHigh)
+                continue;
+
+            // Keep one interval per column: merge overlapping ones, otherwise keep the larger
+            if (lower[column] <= upper[column] && coveredLow <= upper[column] && coveredHigh >= lower[column])
+            {
+                lower[column] = std::min(lower[column], coveredLow);
+                upper[column] = std::max(upper[column], coveredHigh);
+            }
+            else if (lower[column] > upper[column] || coveredHigh - coveredLow > upper[column] - lower[column])
+            {
+                lower[column] = coveredLow;
+                upper[column] = coveredHigh;
+            }
+        }
+    }
+
+    static float cross(const glm::vec2 &origin, const glm::vec2 &a, const glm::vec2 &b)
+    {
+        return (a.x - origin.x) * (b.y - origin.y) - (a.y - origin.y) * (b.x - origin.x);
+    }
+
+    // Lowest and highest y of a convex polygon along the vertical line at x (inside its x range)
+    static void hullSpan(const glm::vec2 *hull, int size, float x, float &low, float &high)
+    {
+        low = 1e30f;
+        high = -1e30f;
+        for (int i = 0; i < size; ++i)
+        {
+            const glm::vec2 &a = hull[i];
+            const glm::vec2 &b = hull[(i + 1) % size];
+            if ((x < a.x && x < b.x) || (x > a.x && x > b.x))
+                continue;
+            float y = (a.x == b.x) ? std::min(a.y, b.y) : a.y + (b.y - a.y) * (x - a.x) / (b.x - a.x);
+            low = std::min(low, y);
+            high = std::max(high, a.x == b.x ? std::max(a.y, b.y) : y);
+        }
+    }
+};
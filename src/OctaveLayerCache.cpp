@@ -0,0 +1,125 @@
+#include <vector>
+
+// Keeps the raw noise of every octave for one grid and frequency ladder. Persistence and
+// baseAmplitude only change the weights between octaves, so while the grid, baseFrequency
+// and lacunarity stay the same a new heightfield is just a weighted sum of cached layers.
+// Growing numOctaves evaluates only the new layers. The cached grid can extend `border`
+// samples past every edge, for chunks whose aprons reach outside the terrain.
+class OctaveLayerCache
+{
+public:
+    OctaveLayerCache(const PerlinNoise &noise, ThreadPool &pool, size_t maxCachedSamples = 64u << 20)
+        : noise(noise), pool(pool), maxCachedSamples(maxCachedSamples),
+          width(0), height(0), border(0), x0(0.0f), spacing(0.0f), baseFrequency(0.0f), lacunarity(0.0f)
+    {
+    }
+
+    // Make layers [0, octaveCount) available for the grid whose sample (x, z) lies at
+    // (x0 + x * spacing, x0 + z * spacing), for -border <= x < width + border and likewise z.
+    // Returns false if they would not fit in the memory budget, in which case the caller
+    // should evaluate the noise directly.
+    bool prepare(int width, int height, int border, float x0, float spacing, float baseFrequency, float lacunarity, int octaveCount)
+    {
+        const size_t layerSize = (size_t)(width + 2 * border) * (height + 2 * border);
+        if (layerSize * octaveCount > maxCachedSamples)
+        {
+            // The caller evaluates the noise directly, so cached layers would only hold memory (a large
+            // grid after a small one); the next grid that fits rebuilds its own
+            std::vector<std::vector<float>>().swap(layers);
+            this->width = 0;
+            return false;
+        }
+
+        layOut(width, height, border, x0, spacing, baseFrequency, lacunarity);
+        while ((int)layers.size() < octaveCount)
+            addLayer();
+
+        return true;
+    }
+
+    // Aim the cache at a grid and frequency ladder without evaluating any layer yet; prepare()
+    // evaluates them. Any change to the sample positions or frequency ladder invalidates every layer.
+    void layOut(int width, int height, int border, float x0, float spacing, float baseFrequency, float lacunarity)
+    {
+        if (isLaidOut(width, height, border, x0, spacing, baseFrequency, lacunarity))
+            return;
+
+        layers.clear();
+        this->width = width;
+        this->height = height;
+        this->border = border;
+        this->x0 = x0;
+        this->spacing = spacing;
+        this->baseFrequency = baseFrequency;
+        this->lacunarity = lacunarity;
+    }
+
+    // Whether the cache is aimed at this grid and frequency ladder, however many layers it holds
+    bool isLaidOut(int width, int height, int border, float x0, float spacing, float baseFrequency, float lacunarity) const
+    {
+        return width == this->width && height == this->height && border == this->border && x0 == this->x0 &&
+               spacing == this->spacing && baseFrequency == this->baseFrequency && lacunarity == this->lacunarity;
+    }
+
+    // Whether prepare() with these arguments would find every layer already cached
+    bool isPrepared(int width, int height, int border, float x0, float spacing, float baseFrequency, float lacunarity, int octaveCount) const
+    {
+        return isLaidOut(width, height, border, x0, spacing, baseFrequency, lacunarity) && (int)layers.size() >= octaveCount;
+    }
+
+    // out[i] = sum of amplitudes[o] * layer o at sample (firstX + i, z), for i < count
+    void combineRow(int z, int firstX, int count, const std::vector<float> &amplitudes, float *out) const
+    {
+        const size_t offset = (size_t)(z + border) * (width + 2 * border) + (firstX + border);
+        for (int x = 0; x < count; ++x)
+            out[x] = 0.0f;
+
+        // Plain multiply-add over contiguous rows; the compiler vectorizes this loop
+        for (size_t o = 0; o < amplitudes.size(); ++o)
+        {
+            const float weight = amplitudes[o];
+            const float *layer = layers[o].data() + offset;
+            for (int x = 0; x < count; ++x)
+                out[x] += weight * layer[x];
+        }
+    }
+
+private:
+    const PerlinNoise &noise;
+    ThreadPool &pool;
+    size_t maxCachedSamples;
+
+    int width;
+    int height;
+    int border;
+    float x0;
+    float spacing;
+    float baseFrequency;
+    float lacunarity;
+    std::vector<std::vector<float>> layers;
+
+    void addLayer()
+    {
+        // Frequency of the next octave, accumulated the same way as PerlinNoise::makeOctaves
+        float frequency = baseFrequency;
+        for (size_t i = 0; i < layers.size(); ++i)
+            frequency *= lacunarity;
+
+        PerlinNoise::Octaves single;
+        single.frequencies.assign(1, frequency);
+        single.amplitudes.assign(1, 1.0f);
+
+        // Positions are computed from the signed grid index, exactly as the uncached path does
+        const int paddedWidth = width + 2 * border;
+        const int paddedHeight = height + 2 * border;
+        std::vector<float> layer((size_t)paddedWidth * paddedHeight);
+        pool.parallelFor(0, paddedHeight, pool.grainFor(paddedHeight), [&](int firstRow, int lastRow) {
+            for (int row = firstRow; row < lastRow; ++row)
+            {
+                int z = row - border;
+                noise.fbmRow(x0, spacing, x0 + z * spacing, single, &layer[(size_t)row * paddedWidth], paddedWidth, -border);
+            }
+        });
+        layers.push_back(std::move(layer));
+    }
+};
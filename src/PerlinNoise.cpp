@@ -1,6 +1,14 @@
 #include <cmath>
 #include <vector>
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define PERLIN_SIMD_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PERLIN_SIMD_SSE2 1
+#endif
+
 class PerlinNoise
 {
 public:
@@ -11,8 +19,93 @@ public:
             p[256 + i] = p[i] = permutation[i];
     }
 
+    // Per-octave frequency and amplitude weights, computed once per terrain generation
+    struct Octaves
+    {
+        std::vector<float> frequencies;
+        std::vector<float> amplitudes;
+    };
+
+    static Octaves makeOctaves(int octaves, float persistence, float lacunarity, float baseFrequency, float baseAmplitude)
+    {
+        Octaves table;
+        table.frequencies.resize(octaves);
+        table.amplitudes.resize(octaves);
+
+        float frequency = baseFrequency;
+        float amplitude = baseAmplitude;
+        for (int i = 0; i < octaves; ++i)
+        {
+            table.frequencies[i] = frequency;
+            table.amplitudes[i] = amplitude;
+
+            amplitude *= persistence;
+            frequency *= lacunarity;
+        }
+        return table;
+    }
+
+    // Fractal Brownian motion: exactly one singleNoise evaluation per octave
+    float fbm(float x, float y, const Octaves &octaves) const
+    {
+        float total = 0.0f;
+        const size_t count = octaves.frequencies.size();
+        for (size_t i = 0; i < count; ++i)
+        {
+            const float frequency = octaves.frequencies[i];
+            total += octaves.amplitudes[i] * singleNoise(x * frequency, y * frequency);
+        }
+        return total;
+    }
+
+    float fbm(float x, float y, int octaves, float persistence, float lacunarity, float baseFrequency, float baseAmplitude) const
+    {
+        return fbm(x, y, makeOctaves(octaves, persistence, lacunarity, baseFrequency, baseAmplitude));
+    }
+
+    // Batch fBm over a row of samples: out[i] = fbm(x0 + (firstIndex + i * indexStep) * dx, y, octaves).
+    // Uses 8-wide AVX2 or 4-wide SSE2 kernels when available; fbm() stays the scalar reference.
+    // Pieces of one grid row evaluated with the same x0 and dx agree exactly with the whole row,
+    // and so do every indexStep-th samples of it.
+    void fbmRow(float x0, float dx, float y, const Octaves &octaves, float *out, int count, int firstIndex = 0, int indexStep = 1) const
+    {
+        for (int i = 0; i < count; ++i)
+            out[i] = 0.0f;
+
+        const size_t octaveCount = octaves.frequencies.size();
+        for (size_t o = 0; o < octaveCount; ++o)
+            addOctaveRow(x0, dx, firstIndex, indexStep, y, octaves.frequencies[o], octaves.amplitudes[o], out, count);
+    }
+
+    // Noise value together with its analytic partial derivatives d/dx and d/dy
+    struct NoiseSample
+    {
+        float value;
+        float dx;
+        float dy;
+    };
+
+    // fbm() plus its exact gradient with respect to (x, y), from the derivative of the fade curve
+    NoiseSample fbmDerivative(float x, float y, const Octaves &octaves) const
+    {
+        NoiseSample total = {0.0f, 0.0f, 0.0f};
+        const size_t count = octaves.frequencies.size();
+        for (size_t i = 0; i < count; ++i)
+        {
+            const float frequency = octaves.frequencies[i];
+            const float amplitude = octaves.amplitudes[i];
+            NoiseSample octave = singleNoiseDerivative(x * frequency, y * frequency);
+
+            // Chain rule: d/dx of N(x * frequency) is frequency * N'
+            total.value += amplitude * octave.value;
+            total.dx += amplitude * frequency * octave.dx;
+            total.dy += amplitude * frequency * octave.dy;
+        }
+        return total;
+    }
+
     // Perlin noise function with octaves and persistence
-    float noise(float x, float y, int octaves, float persistence)
+    float noise(float x, float y, int octaves, float persistence) const
     {
         float total = 0.0f;
         float maxValue = 0.0f; // Used for normalization
@@ -37,17 +130,17 @@ private:
 
     static const int permutation[256];
 
-    float fade(float t)
+    float fade(float t) const
     {
         return t * t * t * (t * (t * 6 - 15) + 10);
     }
 
-    float lerp(float t, float a, float b)
+    float lerp(float t, float a, float b) const
     {
         return a + t * (b - a);
     }
 
-    float grad(int hash, float x, float y)
+    float grad(int hash, float x, float y) const
     {
         int h = hash & 3;
         float u = h < 2 ? x : y;
@@ -55,7 +148,64 @@ private:
         return ((h & 1) == 0 ? u : -u) + ((h & 2) == 0 ? v : -v);
     }
 
-    float singleNoise(float x, float y)
+    // d/dt of fade(t)
+    float fadeDerivative(float t) const
+    {
+        return 30.0f * t * t * (t * (t - 2.0f) + 1.0f);
+    }
+
+    // grad(hash, x, y) is linear in (x, y); these are its coefficients
+    void gradVector(int hash, float &gx, float &gy) const
+    {
+        int h = hash & 3;
+        float su = (h & 1) == 0 ? 1.0f : -1.0f;
+        float sv = (h & 2) == 0 ? 1.0f : -1.0f;
+        gx = h < 2 ? su : sv;
+        gy = h < 2 ? sv : su;
+    }
+
+    // singleNoise() with its partial derivatives. Written as
+    // n = n00 + u (n10 - n00) + v (n01 - n00) + u v (n00 - n10 - n01 + n11)
+    // so both derivatives fall out of the same corner terms.
+    NoiseSample singleNoiseDerivative(float x, float y) const
+    {
+        float floorX = std::floor(x);
+        float floorY = std::floor(y);
+        int X = (int)floorX & 255;
+        int Y = (int)floorY & 255;
+
+        x -= floorX;
+        y -= floorY;
+
+        float u = fade(x);
+        float v = fade(y);
+        float du = fadeDerivative(x);
+        float dv = fadeDerivative(y);
+
+        float g00x, g00y, g10x, g10y, g01x, g01y, g11x, g11y;
+        gradVector(p[p[X] + Y], g00x, g00y);
+        gradVector(p[p[X + 1] + Y], g10x, g10y);
+        gradVector(p[p[X] + Y + 1], g01x, g01y);
+        gradVector(p[p[X + 1] + Y + 1], g11x, g11y);
+
+        float n00 = g00x * x + g00y * y;
+        float n10 = g10x * (x - 1) + g10y * y;
+        float n01 = g01x * x + g01y * (y - 1);
+        float n11 = g11x * (x - 1) + g11y * (y - 1);
+
+        float k1 = n10 - n00;
+        float k2 = n01 - n00;
+        float k3 = n00 - n10 - n01 + n11;
+        float res = n00 + u * k1 + v * k2 + u * v * k3;
+
+        float dx = g00x + u * (g10x - g00x) + v * (g01x - g00x) + u * v * (g00x - g10x - g01x + g11x) + du * (k1 + v * k3);
+        float dy = g00y + u * (g10y - g00y) + v * (g01y - g00y) + u * v * (g00y - g10y - g01y + g11y) + dv * (k2 + u * k3);
+
+        // Same [0, 1] remap as singleNoise, which halves the derivatives
+        return {(res + 1.0f) / 2.0f, dx * 0.5f, dy * 0.5f};
+    }
+
+    float singleNoise(float x, float y) const
     {
         int X = (int)std::floor(x) & 255;
         int Y = (int)std::floor(y) & 255;
@@ -75,6 +225,189 @@ private:
                          lerp(u, grad(ab, x, y - 1), grad(bb, x - 1, y - 1)));
         return (res + 1.0f) / 2.0f; // Normalize to [0, 1]
     }
+
+    // Adds amplitude * singleNoise((x0 + (firstIndex + i * indexStep) * dx) * frequency, y * frequency) to out[0..count)
+    void addOctaveRow(float x0, float dx, int firstIndex, int indexStep, float y, float frequency, float amplitude, float *out, int count) const
+    {
+        // The row shares one y, so its lattice row and fade weight are scalar
+        float fy = y * frequency;
+        float floorY = std::floor(fy);
+        int Y = (int)floorY & 255;
+        fy -= floorY;
+        float v = fade(fy);
+
+        int i = 0;
+
+#if defined(PERLIN_SIMD_AVX2)
+        const int *perm = p.data();
+        const __m256 lane = _mm256_mul_ps(_mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f), _mm256_set1_ps((float)indexStep));
+        const __m256 vdx = _mm256_set1_ps(dx);
+        const __m256 vx0 = _mm256_set1_ps(x0);
+        const __m256 vfreq = _mm256_set1_ps(frequency);
+        const __m256 vamp = _mm256_set1_ps(amplitude * 0.5f);
+        const __m256 one = _mm256_set1_ps(1.0f);
+        const __m256 vfy = _mm256_set1_ps(fy);
+        const __m256 vfy1 = _mm256_set1_ps(fy - 1.0f);
+        const __m256 vv = _mm256_set1_ps(v);
+        const __m256i mask255 = _mm256_set1_epi32(255);
+        const __m256i vY = _mm256_set1_epi32(Y);
+        const __m256i vY1 = _mm256_set1_epi32(Y + 1);
+        const __m256i oneI = _mm256_set1_epi32(1);
+
+        for (; i + 8 <= count; i += 8)
+        {
+            __m256 idx = _mm256_add_ps(_mm256_set1_ps((float)(firstIndex + i * indexStep)), lane);
+            __m256 x = _mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(idx, vdx), vx0), vfreq);
+
+            __m256 floorX = _mm256_floor_ps(x);
+            __m256i X = _mm256_and_si256(_mm256_cvttps_epi32(floorX), mask255);
+            __m256 fx = _mm256_sub_ps(x, floorX);
+            __m256 fx1 = _mm256_sub_ps(fx, one);
+            __m256 u = fade8(fx);
+
+            __m256i pX = _mm256_i32gather_epi32(perm, X, 4);
+            __m256i pX1 = _mm256_i32gather_epi32(perm, _mm256_add_epi32(X, oneI), 4);
+            __m256i aa = _mm256_i32gather_epi32(perm, _mm256_add_epi32(pX, vY), 4);
+            __m256i ab = _mm256_i32gather_epi32(perm, _mm256_add_epi32(pX, vY1), 4);
+            __m256i ba = _mm256_i32gather_epi32(perm, _mm256_add_epi32(pX1, vY), 4);
+            __m256i bb = _mm256_i32gather_epi32(perm, _mm256_add_epi32(pX1, vY1), 4);
+
+            __m256 x1 = lerp8(u, grad8(aa, fx, vfy), grad8(ba, fx1, vfy));
+            __m256 x2 = lerp8(u, grad8(ab, fx, vfy1), grad8(bb, fx1, vfy1));
+            __m256 res = lerp8(vv, x1, x2);
+
+            // out += amplitude * (res + 1) / 2
+            __m256 acc = _mm256_loadu_ps(out + i);
+            acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_add_ps(res, one), vamp));
+            _mm256_storeu_ps(out + i, acc);
+        }
+#elif defined(PERLIN_SIMD_SSE2)
+        const __m128 lane = _mm_mul_ps(_mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f), _mm_set1_ps((float)indexStep));
+        const __m128 vdx = _mm_set1_ps(dx);
+        const __m128 vx0 = _mm_set1_ps(x0);
+        const __m128 vfreq = _mm_set1_ps(frequency);
+        const __m128 vamp = _mm_set1_ps(amplitude * 0.5f);
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 vfy = _mm_set1_ps(fy);
+        const __m128 vfy1 = _mm_set1_ps(fy - 1.0f);
+        const __m128 vv = _mm_set1_ps(v);
+        const __m128i mask255 = _mm_set1_epi32(255);
+
+        alignas(16) int X[4];
+        alignas(16) int hashes[4][4];
+
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128 idx = _mm_add_ps(_mm_set1_ps((float)(firstIndex + i * indexStep)), lane);
+            __m128 x = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(idx, vdx), vx0), vfreq);
+
+            // SSE2 has no floor: truncate, then step down where truncation rounded up
+            __m128 trunc = _mm_cvtepi32_ps(_mm_cvttps_epi32(x));
+            __m128 floorX = _mm_sub_ps(trunc, _mm_and_ps(_mm_cmpgt_ps(trunc, x), one));
+            _mm_store_si128((__m128i *)X, _mm_and_si128(_mm_cvttps_epi32(floorX), mask255));
+            __m128 fx = _mm_sub_ps(x, floorX);
+            __m128 fx1 = _mm_sub_ps(fx, one);
+            __m128 u = fade4(fx);
+
+            // No gather instruction below AVX2, so the permutation lookups stay scalar
+            for (int k = 0; k < 4; ++k)
+            {
+                int pX = p[X[k]];
+                int pX1 = p[X[k] + 1];
+                hashes[0][k] = p[pX + Y];
+                hashes[1][k] = p[pX + Y + 1];
+                hashes[2][k] = p[pX1 + Y];
+                hashes[3][k] = p[pX1 + Y + 1];
+            }
+            __m128i aa = _mm_load_si128((const __m128i *)hashes[0]);
+            __m128i ab = _mm_load_si128((const __m128i *)hashes[1]);
+            __m128i ba = _mm_load_si128((const __m128i *)hashes[2]);
+            __m128i bb = _mm_load_si128((const __m128i *)hashes[3]);
+
+            __m128 x1 = lerp4(u, grad4(aa, fx, vfy), grad4(ba, fx1, vfy));
+            __m128 x2 = lerp4(u, grad4(ab, fx, vfy1), grad4(bb, fx1, vfy1));
+            __m128 res = lerp4(vv, x1, x2);
+
+            __m128 acc = _mm_loadu_ps(out + i);
+            acc = _mm_add_ps(acc, _mm_mul_ps(_mm_add_ps(res, one), vamp));
+            _mm_storeu_ps(out + i, acc);
+        }
+#endif
+
+        // Scalar tail (and the whole row when no SIMD path is compiled in)
+        for (; i < count; ++i)
+        {
+            float x = ((float)(firstIndex + i * indexStep) * dx + x0) * frequency;
+            float floorX = std::floor(x);
+            int X = (int)floorX & 255;
+            x -= floorX;
+            float u = fade(x);
+
+            int aa = p[p[X] + Y];
+            int ab = p[p[X] + Y + 1];
+            int ba = p[p[X + 1] + Y];
+            int bb = p[p[X + 1] + Y + 1];
+
+            float res = lerp(v, lerp(u, grad(aa, x, fy), grad(ba, x - 1, fy)),
+                             lerp(u, grad(ab, x, fy - 1), grad(bb, x - 1, fy - 1)));
+            out[i] += amplitude * (res + 1.0f) / 2.0f;
+        }
+    }
+
+#if defined(PERLIN_SIMD_AVX2)
+    static __m256 fade8(__m256 t)
+    {
+        // t * t * t * (t * (t * 6 - 15) + 10)
+        __m256 inner = _mm256_sub_ps(_mm256_mul_ps(t, _mm256_set1_ps(6.0f)), _mm256_set1_ps(15.0f));
+        inner = _mm256_add_ps(_mm256_mul_ps(t, inner), _mm256_set1_ps(10.0f));
+        return _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(t, t), t), inner);
+    }
+
+    static __m256 lerp8(__m256 t, __m256 a, __m256 b)
+    {
+        return _mm256_add_ps(a, _mm256_mul_ps(t, _mm256_sub_ps(b, a)));
+    }
+
+    // Branchless grad(): bit 1 of the hash swaps x/y and negates the second term, bit 0 negates the first
+    static __m256 grad8(__m256i hash, __m256 x, __m256 y)
+    {
+        __m256i bit0 = _mm256_and_si256(hash, _mm256_set1_epi32(1));
+        __m256i bit1 = _mm256_and_si256(hash, _mm256_set1_epi32(2));
+        __m256 swap = _mm256_castsi256_ps(_mm256_cmpeq_epi32(bit1, _mm256_set1_epi32(2)));
+
+        __m256 u = _mm256_blendv_ps(x, y, swap);
+        __m256 v = _mm256_blendv_ps(y, x, swap);
+        u = _mm256_xor_ps(u, _mm256_castsi256_ps(_mm256_slli_epi32(bit0, 31)));
+        v = _mm256_xor_ps(v, _mm256_castsi256_ps(_mm256_slli_epi32(bit1, 30)));
+        return _mm256_add_ps(u, v);
+    }
+#elif defined(PERLIN_SIMD_SSE2)
+    static __m128 fade4(__m128 t)
+    {
+        __m128 inner = _mm_sub_ps(_mm_mul_ps(t, _mm_set1_ps(6.0f)), _mm_set1_ps(15.0f));
+        inner = _mm_add_ps(_mm_mul_ps(t, inner), _mm_set1_ps(10.0f));
+        return _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(t, t), t), inner);
+    }
+
+    static __m128 lerp4(__m128 t, __m128 a, __m128 b)
+    {
+        return _mm_add_ps(a, _mm_mul_ps(t, _mm_sub_ps(b, a)));
+    }
+
+    // Same branchless select as grad8, using and/andnot since SSE2 has no blendv
+    static __m128 grad4(__m128i hash, __m128 x, __m128 y)
+    {
+        __m128i bit0 = _mm_and_si128(hash, _mm_set1_epi32(1));
+        __m128i bit1 = _mm_and_si128(hash, _mm_set1_epi32(2));
+        __m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(bit1, _mm_set1_epi32(2)));
+
+        __m128 u = _mm_or_ps(_mm_and_ps(swap, y), _mm_andnot_ps(swap, x));
+        __m128 v = _mm_or_ps(_mm_and_ps(swap, x), _mm_andnot_ps(swap, y));
+        u = _mm_xor_ps(u, _mm_castsi128_ps(_mm_slli_epi32(bit0, 31)));
+        v = _mm_xor_ps(v, _mm_castsi128_ps(_mm_slli_epi32(bit1, 30)));
+        return _mm_add_ps(u, v);
+    }
+#endif
 };
 
 // The permutation array must be initialized
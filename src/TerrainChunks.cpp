@@ -0,0 +1,130 @@
+#include <algorithm>
+#include <vector>
+
+// Splits a width x height vertex grid into chunks of up to chunkQuads x chunkQuads quads. Every
+// chunk has its own Heightfield with a one-sample apron around it, so normals along its edges
+// can be computed from the chunk alone and still match the neighbouring chunk. Dirty flags
+// track which chunks need regenerating and which need uploading.
+class TerrainChunks
+{
+public:
+    static constexpr int chunkQuads = 64;                // Quads along a full chunk side
+    static constexpr int chunkVertices = chunkQuads + 1; // Vertices along a full chunk side (fits 16-bit indices)
+    static constexpr int apron = 1;                      // Extra samples stored past each chunk edge
+
+    // Placement of a chunk in the vertex grid
+    struct Extent
+    {
+        int firstX; // Grid coordinates of the chunk's first vertex
+        int firstZ;
+        int quadsX; // Quads covered; chunks on the far edges can be smaller than chunkQuads
+        int quadsZ;
+    };
+
+    struct Chunk
+    {
+        Extent extent;
+        Heightfield heights; // Sample (apron, apron) is grid vertex (firstX, firstZ)
+        float minHeight;     // Height range of the chunk's own vertices (apron excluded)
+        float maxHeight;
+        std::vector<unsigned short> decimatedIndices; // Simplified triangle list in patch vertex numbering; empty when not decimated
+        bool dirty;          // Heights need to be regenerated
+        bool uploadPending;  // Heights changed since the last upload
+        bool indicesPending; // Only decimatedIndices changed since the last upload
+    };
+
+    TerrainChunks()
+        : gridWidth(0), gridHeight(0), gridSpacing(0.0f), gridOriginX(0.0f), gridOriginZ(0.0f), chunksX(0), chunksZ(0)
+    {
+    }
+
+    // Lay out chunks for a grid whose vertex (x, z) lies at (originX + x * spacing, originZ + z * spacing).
+    // A new layout marks every chunk dirty and returns true; the same layout is a no-op.
+    bool resize(int width, int height, float spacing, float originX, float originZ)
+    {
+        if (width == gridWidth && height == gridHeight && spacing == gridSpacing &&
+            originX == gridOriginX && originZ == gridOriginZ && !chunkList.empty())
+            return false;
+
+        gridWidth = width;
+        gridHeight = height;
+        gridSpacing = spacing;
+        gridOriginX = originX;
+        gridOriginZ = originZ;
+        chunksX = (width - 1 + chunkQuads - 1) / chunkQuads;
+        chunksZ = (height - 1 + chunkQuads - 1) / chunkQuads;
+
+        chunkList.resize((size_t)chunksX * chunksZ);
+        for (int cz = 0; cz < chunksZ; ++cz)
+        {
+            for (int cx = 0; cx < chunksX; ++cx)
+            {
+                Chunk &chunk = chunkList[(size_t)cz * chunksX + cx];
+                chunk.extent.firstX = cx * chunkQuads;
+                chunk.extent.firstZ = cz * chunkQuads;
+                chunk.extent.quadsX = std::min(chunkQuads, width - 1 - chunk.extent.firstX);
+                chunk.extent.quadsZ = std::min(chunkQuads, height - 1 - chunk.extent.firstZ);
+                chunk.heights.resize(chunk.extent.quadsX + 1 + 2 * apron, chunk.extent.quadsZ + 1 + 2 * apron, spacing,
+                                     worldX(chunk.extent.firstX - apron), worldZ(chunk.extent.firstZ - apron));
+            }
+        }
+
+        markAllDirty();
+        return true;
+    }
+
+    void markAllDirty()
+    {
+        for (Chunk &chunk : chunkList)
+            chunk.dirty = true;
+    }
+
+    int width() const { return gridWidth; }
+    int height() const { return gridHeight; }
+    float spacing() const { return gridSpacing; }
+    float originX() const { return gridOriginX; }
+    float originZ() const { return gridOriginZ; }
+    int chunkCountX() const { return chunksX; }
+    int chunkCountZ() const { return chunksZ; }
+    size_t size() const { return chunkList.size(); }
+    bool empty() const { return chunkList.empty(); }
+
+    // Model-space coordinates of a grid column / row; also valid for apron indices
+    float worldX(int x) const { return gridOriginX + x * gridSpacing; }
+    float worldZ(int z) const { return gridOriginZ + z * gridSpacing; }
+
+    Chunk &chunk(size_t index) { return chunkList[index]; }
+    const Chunk &chunk(size_t index) const { return chunkList[index]; }
+
+    // Height of grid vertex (x, z), read from the chunk that contains it. Apron samples past
+    // the grid edges (x = -1 or x = width) are valid too.
+    float heightAt(int x, int z) const
+    {
+        int cx = std::min(std::max(x, 0) / chunkQuads, chunksX - 1);
+        int cz = std::min(std::max(z, 0) / chunkQuads, chunksZ - 1);
+        const Chunk &owner = chunkList[(size_t)cz * chunksX + cx];
+        return owner.heights.at(x - owner.extent.firstX + apron, z - owner.extent.firstZ + apron);
+    }
+
+    void swap(TerrainChunks &other)
+    {
+        std::swap(gridWidth, other.gridWidth);
+        std::swap(gridHeight, other.gridHeight);
+        std::swap(gridSpacing, other.gridSpacing);
+        std::swap(gridOriginX, other.gridOriginX);
+        std::swap(gridOriginZ, other.gridOriginZ);
+        std::swap(chunksX, other.chunksX);
+        std::swap(chunksZ, other.chunksZ);
+        chunkList.swap(other.chunkList);
+    }
+
+private:
+    int gridWidth;
+    int gridHeight;
+    float gridSpacing;
+    float gridOriginX;
+    float gridOriginZ;
+    int chunksX;
+    int chunksZ;
+    std::vector<Chunk> chunkList;
+};
@@ -0,0 +1,347 @@
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// Bounded cache of streamed terrain tiles for an endless world. A tile at level l covers
+// tileQuads x tileQuads quads at a sample spacing of spacing * 2^l, so four level-l tiles make
+// one level-(l + 1) tile. Missing tiles are generated on the thread pool, nearest first, while
+// the caller keeps drawing whatever is resident; when the cache is full the least recently
+// used tile is evicted. select() walks the tiles around a centre point like a quadtree and
+// falls back to a coarser resident tile wherever a finer one is not ready yet.
+class TerrainTileCache
+{
+public:
+    static constexpr int tileQuads = TerrainChunks::chunkQuads;    // Same patch as the chunked terrain
+    static constexpr int tileVertices = tileQuads + 1;
+    static constexpr int apron = 1;                                // Extra samples past each edge, for normals
+    static constexpr int tileSamples = tileVertices + 2 * apron;   // Samples along a tile's heightfield
+
+    struct TileKey
+    {
+        int level;
+        int x; // Tile index at its level; tile (x, z) starts at sample (x, z) * tileQuads
+        int z;
+
+        bool operator==(const TileKey &other) const { return level == other.level && x == other.x && z == other.z; }
+    };
+
+    // A resident tile (or one quadrant of it) to draw
+    struct Draw
+    {
+        int slot;
+        TileKey key;
+        int quadrant; // -1 for the whole tile, otherwise 0-3 (x-major: top-left, top-right, bottom-left, bottom-right)
+    };
+
+    TerrainTileCache(const PerlinNoise &noise, ThreadPool &pool, int capacity = 256, int maxInFlight = 8)
+        : perlin(noise), threadPool(pool), slots(capacity), inFlightLimit(maxInFlight), inFlight(0), epoch(0), frame(0),
+          baseSpacing(0.0f), octaveCount(0), persistence(0.0f), lacunarity(0.0f), baseFrequency(0.0f)
+    {
+    }
+
+    // Generation tasks refer to the cache, so wait for them
+    ~TerrainTileCache()
+    {
+        std::unique_lock<std::mutex> lock(completionMutex);
+        allDone.wait(lock, [this] { return inFlight == 0; });
+    }
+
+    TerrainTileCache(const TerrainTileCache &) = delete;
+    TerrainTileCache &operator=(const TerrainTileCache &) = delete;
+
+    // Set the level-0 sample spacing and the noise parameters. Any change drops every tile;
+    // tiles still being generated with the old settings are discarded when they finish.
+    void configure(float spacing, int octaves, float octavePersistence, float octaveLacunarity, float frequency)
+    {
+        if (spacing == baseSpacing && octaves == octaveCount && octavePersistence == persistence &&
+            octaveLacunarity == lacunarity && frequency == baseFrequency)
+            return;
+
+        baseSpacing = spacing;
+        octaveCount = octaves;
+        persistence = octavePersistence;
+        lacunarity = octaveLacunarity;
+        baseFrequency = frequency;
+        octaveTable = std::make_shared<const PerlinNoise::Octaves>(
+            PerlinNoise::makeOctaves(octaves, octavePersistence, octaveLacunarity, frequency, 1.0f));
+
+        ++epoch;
+        tileSlots.clear();
+        for (Slot &slot : slots)
+        {
+            if (slot.state != SlotState::Generating)
+                slot.state = SlotState::Free;
+        }
+    }
+
+    // Pick the tiles to draw around the model-space point (centerX, centerZ): every tile of the
+    // coarsest level within `radius` tiles, refined down to level 0 wherever a tile lies within
+    // refineRange tile widths of the centre. Requests the tiles it would like to draw and starts
+    // generating the most urgent ones; never waits for them.
+    void select(float centerX, float centerZ, int levels, int radius, float refineRange, std::vector<Draw> &draws)
+    {
+        draws.clear();
+        requests.clear();
+        ++frame;
+        if (baseSpacing <= 0.0f)
+            return;
+
+        const int top = levels - 1;
+        const float size = tileSize(top);
+        const int centerTileX = (int)std::floor(centerX / size);
+        const int centerTileZ = (int)std::floor(centerZ / size);
+        for (int z = centerTileZ - radius; z <= centerTileZ + radius; ++z)
+        {
+            for (int x = centerTileX - radius; x <= centerTileX + radius; ++x)
+                selectTile({top, x, z}, centerX, centerZ, refineRange, draws);
+        }
+
+        dispatch();
+    }
+
+    // Tiles that finished generating since the last call, now resident. Their heights must be
+    // uploaded before they are drawn.
+    void collectCompleted(std::vector<int> &completedSlots)
+    {
+        completedSlots.clear();
+
+        std::vector<Completion> finished;
+        {
+            std::lock_guard<std::mutex> lock(completionMutex);
+            finished.swap(completions);
+        }
+
+        for (const Completion &completion : finished)
+        {
+            Slot &slot = slots[completion.slot];
+            if (completion.epoch != epoch)
+            {
+                slot.state = SlotState::Free; // Generated with old settings
+                continue;
+            }
+            slot.state = SlotState::Resident;
+            slot.lastUsed = frame;
+            completedSlots.push_back(completion.slot);
+        }
+    }
+
+    int capacity() const { return (int)slots.size(); }
+    size_t residentCount() const { return (size_t)std::count_if(slots.begin(), slots.end(), [](const Slot &slot) { return slot.state == SlotState::Resident; }); }
+
+    // Distance between samples / width of a tile at a level
+    float tileSpacing(int level) const { return std::ldexp(baseSpacing, level); }
+    float tileSize(int level) const { return tileSpacing(level) * tileQuads; }
+
+    // How far the skirts of a level's tiles hang below their edges
+    float skirtDepth(int level) const { return 0.1f * tileSize(level); }
+
+    // Model-space bounding box of a draw (skirts included). Heights are scaled by heightScale.
+    void drawBounds(const Draw &draw, float heightScale, glm::vec3 &boxMin, glm::vec3 &boxMax) const
+    {
+        const Slot &slot = slots[draw.slot];
+        const float size = tileSize(draw.key.level);
+        const float extent = draw.quadrant < 0 ? size : size * 0.5f;
+        float minX = draw.key.x * size;
+        float minZ = draw.key.z * size;
+        if (draw.quadrant >= 0)
+        {
+            minX += (draw.quadrant & 1) * extent;
+            minZ += (draw.quadrant >> 1) * extent;
+        }
+
+        float minY = std::min(slot.minHeight * heightScale, slot.maxHeight * heightScale);
+        float maxY = std::max(slot.minHeight * heightScale, slot.maxHeight * heightScale);
+        boxMin = glm::vec3(minX, minY - skirtDepth(draw.key.level), minZ);
+        boxMax = glm::vec3(minX + extent, maxY, minZ + extent);
+    }
+
+    // The tileSamples x tileSamples heights of a resident slot; sample (apron, apron) is the tile's first vertex
+    const float *tileHeights(int slot) const { return slots[slot].heights.data(); }
+
+private:
+    enum class SlotState
+    {
+        Free,
+        Generating,
+        Resident
+    };
+
+    struct Slot
+    {
+        SlotState state = SlotState::Free;
+        TileKey key = {0, 0, 0};
+        uint64_t lastUsed = 0;      // Frame the tile was last selected
+        std::vector<float> heights; // Written by the generation task only while Generating
+        float minHeight = 0.0f;     // Height range of the tile's own vertices (apron excluded)
+        float maxHeight = 0.0f;
+    };
+
+    struct Request
+    {
+        TileKey key;
+        float distance;
+    };
+
+    struct Completion
+    {
+        int slot;
+        uint64_t epoch;
+    };
+
+    struct TileKeyHash
+    {
+        size_t operator()(const TileKey &key) const
+        {
+            uint64_t packed = ((uint64_t)(uint32_t)key.x << 32) ^ (uint64_t)(uint32_t)key.z ^ ((uint64_t)key.level << 59);
+            return std::hash<uint64_t>()(packed);
+        }
+    };
+
+    const PerlinNoise &perlin;
+    ThreadPool &threadPool;
+    std::vector<Slot> slots;
+    std::unordered_map<TileKey, int, TileKeyHash> tileSlots; // Tiles generating or resident
+    std::vector<Request> requests;                           // Missing tiles wanted this frame
+    int inFlightLimit;
+
+    std::mutex completionMutex; // Guards completions and inFlight
+    std::condition_variable allDone;
+    std::vector<Completion> completions;
+    int inFlight;
+
+    uint64_t epoch; // Bumped by configure()
+    uint64_t frame;
+
+    float baseSpacing;
+    int octaveCount;
+    float persistence;
+    float lacunarity;
+    float baseFrequency;
+    std::shared_ptr<const PerlinNoise::Octaves> octaveTable; // Shared with running tasks
+
+    // Returns false if the tile is not resident yet
+    bool selectTile(const TileKey &key, float centerX, float centerZ, float refineRange, std::vector<Draw> &draws)
+    {
+        const float size = tileSize(key.level);
+        const float offsetX = centerX - std::min(std::max(centerX, key.x * size), (key.x + 1) * size);
+        const float offsetZ = centerZ - std::min(std::max(centerZ, key.z * size), (key.z + 1) * size);
+        const float distance = std::sqrt(offsetX * offsetX + offsetZ * offsetZ);
+
+        auto found = tileSlots.find(key);
+        if (found == tileSlots.end())
+        {
+            requests.push_back({key, distance});
+            return false;
+        }
+        Slot &slot = slots[found->second];
+        if (slot.state != SlotState::Resident)
+            return false;
+        slot.lastUsed = frame;
+
+        if (key.level > 0 && distance < refineRange * size)
+        {
+            // Children that are not ready yet are covered by this tile's matching quadrant
+            for (int quadrant = 0; quadrant < 4; ++quadrant)
+            {
+                TileKey child = {key.level - 1, 2 * key.x + (quadrant & 1), 2 * key.z + (quadrant >> 1)};
+                if (!selectTile(child, centerX, centerZ, refineRange, draws))
+                    draws.push_back({found->second, key, quadrant});
+            }
+        }
+        else
+        {
+            draws.push_back({found->second, key, -1});
+        }
+        return true;
+    }
+
+    // Start generating the nearest requested tiles (coarser first on ties), up to the in-flight limit
+    void dispatch()
+    {
+        std::sort(requests.begin(), requests.end(), [](const Request &a, const Request &b) {
+            return a.distance != b.distance ? a.distance < b.distance : a.key.level > b.key.level;
+        });
+
+        for (const Request &request : requests)
+        {
+            {
+                std::lock_guard<std::mutex> lock(completionMutex);
+                if (inFlight >= inFlightLimit)
+                    return;
+                ++inFlight;
+            }
+
+            int slotIndex = claimSlot();
+            if (slotIndex < 0)
+            {
+                std::lock_guard<std::mutex> lock(completionMutex);
+                --inFlight;
+                return; // Everything resident is in use this frame
+            }
+
+            Slot &slot = slots[slotIndex];
+            slot.state = SlotState::Generating;
+            slot.key = request.key;
+            slot.heights.resize((size_t)tileSamples * tileSamples);
+            tileSlots[request.key] = slotIndex;
+
+            const uint64_t taskEpoch = epoch;
+            const float spacing = tileSpacing(request.key.level);
+            std::shared_ptr<const PerlinNoise::Octaves> octaves = octaveTable;
+            const TileKey key = request.key;
+            threadPool.submit([this, slotIndex, taskEpoch, spacing, octaves, key] {
+                generateTile(key, spacing, *octaves, slots[slotIndex]);
+
+                std::lock_guard<std::mutex> lock(completionMutex);
+                completions.push_back({slotIndex, taskEpoch});
+                if (--inFlight == 0)
+                    allDone.notify_all();
+            });
+        }
+    }
+
+    // A free slot, or the least recently used resident tile not selected this frame
+    int claimSlot()
+    {
+        int victim = -1;
+        for (int i = 0; i < (int)slots.size(); ++i)
+        {
+            const Slot &slot = slots[i];
+            if (slot.state == SlotState::Free)
+                return i;
+            if (slot.state == SlotState::Resident && slot.lastUsed < frame && (victim < 0 || slot.lastUsed < slots[victim].lastUsed))
+                victim = i;
+        }
+        if (victim >= 0)
+            tileSlots.erase(slots[victim].key);
+        return victim;
+    }
+
+    // Sample (x, z) of a level is the noise at (x, z) * spacing, the same position as sample
+    // (2x, 2z) one level finer, so tiles of different levels agree wherever their samples coincide
+    void generateTile(const TileKey &key, float spacing, const PerlinNoise::Octaves &octaves, Slot &slot) const
+    {
+        const int firstX = key.x * tileQuads - apron;
+        const int firstZ = key.z * tileQuads - apron;
+        float *heights = slot.heights.data();
+        for (int row = 0; row < tileSamples; ++row)
+            perlin.fbmRow(0.0f, spacing, (firstZ + row) * spacing, octaves, heights + (size_t)row * tileSamples, tileSamples, firstX);
+
+        slot.minHeight = FLT_MAX;
+        slot.maxHeight = -FLT_MAX;
+        for (int row = apron; row < apron + tileVertices; ++row)
+        {
+            const float *first = heights + (size_t)row * tileSamples + apron;
+            auto range = std::minmax_element(first, first + tileVertices);
+            slot.minHeight = std::min(slot.minHeight, *range.first);
+            slot.maxHeight = std::max(slot.maxHeight, *range.second);
+        }
+    }
+};
@@ -0,0 +1,227 @@
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing thread pool. Each worker owns a task deque: it pops its own
+// work LIFO (cache-warm) and steals from the other end of its siblings' deques
+// when it runs dry. Threads that wait on a parallelFor help execute tasks, so
+// nested parallel loops cannot deadlock the pool.
+class ThreadPool
+{
+public:
+    explicit ThreadPool(unsigned int threadCount = std::thread::hardware_concurrency())
+        : stopping(false), queuedTasks(0), nextQueue(0)
+    {
+        threadCount = std::max(1u, threadCount);
+        for (unsigned int i = 0; i < threadCount; ++i)
+            queues.push_back(std::make_unique<WorkQueue>());
+
+        for (unsigned int i = 0; i < threadCount; ++i)
+            threads.emplace_back([this, i] { workerLoop((int)i); });
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread &thread : threads)
+            thread.join();
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    size_t size() const
+    {
+        return threads.size();
+    }
+
+    // Queue a task. Tasks submitted from a worker go to that worker's own deque.
+    void submit(std::function<void()> task)
+    {
+        int index = currentWorker();
+        if (index < 0)
+            index = (int)(nextQueue.fetch_add(1, std::memory_order_relaxed) % queues.size());
+
+        // Count the task before publishing it: a thief may pop and run it (decrementing the
+        // count) as soon as it is in the deque
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            ++queuedTasks;
+        }
+        {
+            std::lock_guard<std::mutex> lock(queues[index]->mutex);
+            queues[index]->tasks.push_back(std::move(task));
+        }
+        wake.notify_one();
+    }
+
+    // Run body(first, last) over [begin, end) split into chunks of at most `grain`
+    // items, and block until every chunk is done. The calling thread takes part.
+    // The chunking is independent of the thread count, so results written per
+    // index are deterministic.
+    void parallelFor(int begin, int end, int grain, const std::function<void(int, int)> &body)
+    {
+        if (end <= begin)
+            return;
+        grain = std::max(1, grain);
+
+        const int chunkCount = (end - begin + grain - 1) / grain;
+        if (chunkCount == 1)
+        {
+            body(begin, end);
+            return;
+        }
+
+        struct LoopState
+        {
+            std::atomic<int> remaining;
+            std::mutex errorMutex;
+            std::exception_ptr error;
+        };
+        auto state = std::make_shared<LoopState>();
+        state->remaining = chunkCount;
+
+        for (int chunk = 0; chunk < chunkCount; ++chunk)
+        {
+            const int first = begin + chunk * grain;
+            const int last = std::min(end, first + grain);
+            submit([state, &body, first, last] {
+                try
+                {
+                    body(first, last);
+                }
+                catch (...)
+                {
+                    std::lock_guard<std::mutex> lock(state->errorMutex);
+                    if (!state->error)
+                        state->error = std::current_exception();
+                }
+                state->remaining.fetch_sub(1, std::memory_order_acq_rel);
+            });
+        }
+
+        // Help out instead of sleeping; only yield once there is nothing left to steal
+        while (state->remaining.load(std::memory_order_acquire) > 0)
+        {
+            if (!runOneTask(currentWorker()))
+                std::this_thread::yield();
+        }
+
+        if (state->error)
+            std::rethrow_exception(state->error);
+    }
+
+    // Suggested chunk size for splitting `count` items across the pool
+    int grainFor(int count, int chunksPerThread = 4) const
+    {
+        return std::max(1, count / (int)(threads.size() * chunksPerThread));
+    }
+
+private:
+    struct WorkQueue
+    {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    std::vector<std::thread> threads;
+
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    bool stopping;
+    size_t queuedTasks;
+    std::atomic<unsigned int> nextQueue;
+
+    // Index of the worker running on this thread, or -1 for outside threads
+    int currentWorker() const
+    {
+        return workerOwner() == this ? workerIndex() : -1;
+    }
+
+    static const ThreadPool *&workerOwner()
+    {
+        static thread_local const ThreadPool *owner = nullptr;
+        return owner;
+    }
+
+    static int &workerIndex()
+    {
+        static thread_local int index = -1;
+        return index;
+    }
+
+    bool popTask(int index, bool fromBack, std::function<void()> &task)
+    {
+        WorkQueue &queue = *queues[index];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty())
+            return false;
+
+        if (fromBack)
+        {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+        }
+        else
+        {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+        }
+        return true;
+    }
+
+    // Run one task from our own deque, or steal one. Returns false if all deques are empty.
+    bool runOneTask(int self)
+    {
+        std::function<void()> task;
+        bool found = self >= 0 && popTask(self, true, task);
+
+        const int count = (int)queues.size();
+        const int start = self >= 0 ? self + 1 : 0;
+        for (int i = 0; !found && i < count; ++i)
+        {
+            int victim = (start + i) % count;
+            if (victim != self)
+                found = popTask(victim, false, task);
+        }
+
+        if (!found)
+            return false;
+
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            --queuedTasks;
+        }
+        task();
+        return true;
+    }
+
+    void workerLoop(int index)
+    {
+        workerOwner() = this;
+        workerIndex() = index;
+
+        while (true)
+        {
+            if (runOneTask(index))
+                continue;
+
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            wake.wait(lock, [this] { return stopping || queuedTasks > 0; });
+            if (stopping && queuedTasks == 0)
+                return;
+        }
+    }
+};
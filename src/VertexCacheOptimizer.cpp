@@ -0,0 +1,209 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// Reorders triangle lists for the GPU's post-transform vertex cache, after Tom Forsyth's "Linear-Speed
+// Vertex Cache Optimisation". Vertices are scored by their position in a simulated LRU cache and by
+// how few of their triangles are left (so lone triangles are not stranded), and the next triangle is
+// always the highest scoring one among those touching the cache. Every triangle keeps its corner
+// order, so the winding is unchanged.
+//
+// averageCacheMissRatio (ACMR) measures the result: vertex shader invocations per triangle with a
+// FIFO cache, from 3 for no reuse down to about 0.5 for a large regular grid.
+class VertexCacheOptimizer
+{
+public:
+    static constexpr int cacheSize = 32; // Entries of the simulated cache; typical of current GPUs
+
+    // Reorder the count / 3 triangles starting at `indices` in place
+    void optimize(unsigned short *indices, size_t count)
+    {
+        const int triangleCount = (int)(count / 3);
+        if (triangleCount < 2)
+            return;
+
+        int vertexCount = 0;
+        for (size_t i = 0; i < count; ++i)
+            vertexCount = std::max(vertexCount, (int)indices[i] + 1);
+
+        // Triangles of each vertex, as ranges of vertexTriangles; the first `remaining` are not yet emitted
+        remaining.assign(vertexCount, 0);
+        for (size_t i = 0; i < count; ++i)
+            ++remaining[indices[i]];
+        firstTriangle.assign(vertexCount + 1, 0);
+        for (int v = 0; v < vertexCount; ++v)
+            firstTriangle[v + 1] = firstTriangle[v] + remaining[v];
+        vertexTriangles.resize(count);
+        std::fill(remaining.begin(), remaining.end(), 0);
+        for (int t = 0; t < triangleCount; ++t)
+        {
+            for (int corner = 0; corner < 3; ++corner)
+            {
+                const int v = indices[t * 3 + corner];
+                vertexTriangles[firstTriangle[v] + remaining[v]++] = t;
+            }
+        }
+
+        cachePosition.assign(vertexCount, -1);
+        vertexScores.resize(vertexCount);
+        for (int v = 0; v < vertexCount; ++v)
+            vertexScores[v] = vertexScore(-1, remaining[v]);
+
+        triangleScores.resize(triangleCount);
+        emitted.assign(triangleCount, false);
+        int best = 0;
+        for (int t = 0; t < triangleCount; ++t)
+        {
+            triangleScores[t] = triangleScore(indices, t);
+            if (triangleScores[t] > triangleScores[best])
+                best = t;
+        }
+
+        ordered.clear();
+        ordered.reserve(count);
+        cache.clear();
+        int nextUnemitted = 0;
+        for (int emittedCount = 0; emittedCount < triangleCount; ++emittedCount)
+        {
+            if (best < 0)
+            {
+                // Nothing in the cache has triangles left: continue with the next one in input order
+                while (emitted[nextUnemitted])
+                    ++nextUnemitted;
+                best = nextUnemitted;
+            }
+
+            emitted[best] = true;
+            for (int corner = 0; corner < 3; ++corner)
+            {
+                const int v = indices[best * 3 + corner];
+                ordered.push_back((unsigned short)v);
+                removeTriangle(v, best);
+            }
+
+            // The triangle's vertices move to the front of the cache; whatever falls off the end is evicted
+            updatedCache.clear();
+            for (int corner = 0; corner < 3; ++corner)
+                updatedCache.push_back(indices[best * 3 + corner]);
+            for (int v : cache)
+            {
+                if (v != updatedCache[0] && v != updatedCache[1] && v != updatedCache[2])
+                    updatedCache.push_back(v);
+            }
+            for (size_t i = 0; i < updatedCache.size(); ++i)
+            {
+                const int v = updatedCache[i];
+                cachePosition[v] = i < (size_t)cacheSize ? (int)i : -1;
+                vertexScores[v] = vertexScore(cachePosition[v], remaining[v]);
+            }
+
+            // Rescore the triangles around the cache and pick the best of them
+            best = -1;
+            float bestScore = -1.0f;
+            for (int v : updatedCache)
+            {
+                for (int i = firstTriangle[v]; i < firstTriangle[v] + remaining[v]; ++i)
+                {
+                    const int t = vertexTriangles[i];
+                    triangleScores[t] = triangleScore(indices, t);
+                    if (triangleScores[t] > bestScore)
+                    {
+                        best = t;
+                        bestScore = triangleScores[t];
+                    }
+                }
+            }
+
+            if (updatedCache.size() > (size_t)cacheSize)
+                updatedCache.resize(cacheSize);
+            cache.swap(updatedCache);
+        }
+
+        std::copy(ordered.begin(), ordered.end(), indices);
+    }
+
+    // Vertex shader invocations per triangle for a FIFO cache of fifoSize entries. With `strips`, the
+    // indices are triangle strips separated by restartIndex (which does not flush the cache).
+    static float averageCacheMissRatio(const unsigned short *indices, size_t count, bool strips, unsigned short restartIndex,
+                                       int fifoSize = cacheSize)
+    {
+        std::vector<int> fifo(fifoSize, -1);
+        size_t next = 0;
+        size_t misses = 0;
+        size_t triangles = 0;
+        size_t stripLength = 0;
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (strips && indices[i] == restartIndex)
+            {
+                stripLength = 0;
+                continue;
+            }
+
+            if (std::find(fifo.begin(), fifo.end(), (int)indices[i]) == fifo.end())
+            {
+                fifo[next] = indices[i];
+                next = (next + 1) % fifo.size();
+                ++misses;
+            }
+
+            if (strips && ++stripLength >= 3)
+                ++triangles;
+        }
+        if (!strips)
+            triangles = count / 3;
+        return triangles > 0 ? (float)misses / triangles : 0.0f;
+    }
+
+private:
+    std::vector<int> remaining;       // Triangles of each vertex not yet emitted
+    std::vector<int> firstTriangle;   // Start of each vertex's triangles in vertexTriangles
+    std::vector<int> vertexTriangles;
+    std::vector<int> cachePosition;   // -1 when not in the cache
+    std::vector<float> vertexScores;
+    std::vector<float> triangleScores;
+    std::vector<bool> emitted;
+    std::vector<int> cache;           // Most recently used first
+    std::vector<int> updatedCache;
+    std::vector<unsigned short> ordered;
+
+    static float vertexScore(int position, int trianglesLeft)
+    {
+        if (trianglesLeft == 0)
+            return -1.0f; // Never needed again
+
+        float score = 0.0f;
+        if (position >= 0)
+        {
+            // The last triangle's vertices get a fixed score, so the next triangle does not simply
+            // reuse its newest edge (which would make long thin strips)
+            if (position < 3)
+                score = 0.75f;
+            else
+                score = std::pow(1.0f - (float)(position - 3) / (cacheSize - 3), 1.5f);
+        }
+
+        // Boost vertices with few triangles left
+        return score + 2.0f / std::sqrt((float)trianglesLeft);
+    }
+
+    float triangleScore(const unsigned short *indices, int triangle) const
+    {
+        return vertexScores[indices[triangle * 3]] + vertexScores[indices[triangle * 3 + 1]] + vertexScores[indices[triangle * 3 + 2]];
+    }
+
+    // Move an emitted triangle out of the first `remaining` of a vertex's triangles
+    void removeTriangle(int vertex, int triangle)
+    {
+        const int first = firstTriangle[vertex];
+        const int last = first + --remaining[vertex];
+        for (int i = first; i <= last; ++i)
+        {
+            if (vertexTriangles[i] == triangle)
+            {
+                std::swap(vertexTriangles[i], vertexTriangles[last]);
+                return;
+            }
+        }
+    }
+};
@@ -6,8 +6,20 @@
 #include <iostream>
 #include <vector>
 #include <cmath>
+#include <chrono>
 #include "PerlinNoise.cpp"
 #include "ArcballCamera.cpp"
+#include "ThreadPool.cpp"
+#include "OctaveLayerCache.cpp"
+#include "Heightfield.cpp"
+#include "TerrainChunks.cpp"
+#include "VertexCacheOptimizer.cpp"
+#include "HeightfieldDecimator.cpp"
+#include "CdlodQuadtree.cpp"
+#include "GeometryClipmap.cpp"
+#include "TerrainTileCache.cpp"
+#include "FrustumCuller.cpp"
+#include "HorizonCuller.cpp"
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
@@ -15,6 +27,11 @@
 #include <curl/curl.h>
 #include "json.hpp" // For nlohmann::json
 #include <sstream>
+#include <stack>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
 
 // ImGui headers
 #include "imgui.h"
@@ -25,6 +42,7 @@
 static ImGuiTextBuffer chatHistory;
 static char inputBuffer[256] = "";
 static bool scrollToBottom = false;
+static bool resolutionInputOutdated = true; // The resolution row is reloaded from ::width, which a command may have changed
 
 // Global variables for terrain parameters
 int numOctaves = 4;
@@ -37,35 +55,259 @@ float baseFrequency = 0.4f;
 std::vector<nlohmann::json> conversationHistory;
 
 // Terrain data structures
-std::vector<float> vertices;
-std::vector<unsigned int> indices;
-std::vector<float> normals;
+// terrainChunks is the CPU copy of the terrain; GPU data is derived from it chunk by chunk.
+// The LLM worker borrows it as the generation target while a command is pending; meanwhile the
+// latest preview of a progressively refined edit, if any, is drawn from terrainPreviewChunks.
+TerrainChunks terrainChunks;
+TerrainChunks *terrainPreviewChunks = nullptr; // A refinement level the worker lends until the edit finishes
+std::vector<unsigned short> indices; // Shared by every chunk
+
+// How buildTerrainIndices lays out the shared patch (GeometryClipmap and decimated chunks always use lists)
+enum class TerrainIndexFormat
+{
+    TriangleList, // 6 indices per quad
+    TriangleStrip // One strip per row of quads, separated by terrainRestartIndex (default)
+};
+TerrainIndexFormat terrainIndexFormat = TerrainIndexFormat::TriangleStrip;
+const unsigned short terrainRestartIndex = 0xFFFF; // Never a vertex: a patch has (chunkVertices^2) * 2 at most
+
+// Order terrain indices for the post-transform vertex cache: VertexCacheOptimizer for triangle
+// lists, cache-sized bands of rows for strips
+bool vertexCacheOptimization = true;
+
+// Floats per terrain vertex in the VBO: position (3), texture coordinates (2), normal (3)
+const int terrainVertexFloats = 8;
+
+// Compact terrain vertex (4 bytes instead of 32). Position and texture coordinates follow from
+// the vertex's place in its chunk's patch, so only the height and normal are stored.
+struct CompactTerrainVertex
+{
+    unsigned short height; // Unit-amplitude height mapped from the grid's quantization range onto 0-65535
+    signed char normal[2]; // Octahedral-encoded unit normal, snorm8
+};
+
+// Use CompactTerrainVertex in the VertexBuffer mode (decoded in the vertex shader)
+bool compactVertexFormat = true;
 
-// Terrain dimensions
+// Terrain dimensions: vertices along each side of the grid (always square), settable at runtime
+// from the UI and the LLM within [minTerrainResolution, maxTerrainResolution]
 int width = 500;
 int height = 500;
+const int minTerrainResolution = 128;
+int maxTerrainResolution = 8192; // Lowered at startup if the height texture would not fit
+
+// How writeChunkVertices computes vertex normals. Only TerrainRenderMode::VertexBuffer stores
+// them; every other mode takes central differences of the heights in the vertex shader, so
+// startup falls back to CentralDifference there.
+enum class NormalMode
+{
+    CentralDifference, // One streaming pass over the heightfield (default)
+    TriangleAverage,   // Average of the adjacent face normals
+    Analytic           // Exact fBm gradient from the noise derivatives
+};
+NormalMode terrainNormalMode = NormalMode::CentralDifference;
+
+// How the terrain mesh reaches the GPU
+enum class TerrainRenderMode
+{
+    Cdlod,         // Height texture drawn through the CDLOD quadtree: coarser nodes further from the camera (default)
+    HeightTexture, // Heights only, as an R32F texture; the vertex shader rebuilds each vertex from gl_VertexID
+    VertexBuffer,  // Full interleaved vertices (needed for the TriangleAverage and Analytic normal modes)
+    Clipmap,       // Nested rings around camera.Target with their own toroidally updated heights; the terrain has no edge
+    Streaming      // Endless tiles generated in the background around camera.Target; coarser tiles stand in until finer ones are ready
+};
+TerrainRenderMode terrainRenderMode = TerrainRenderMode::Cdlod;
+
+// CDLOD level-of-detail settings (TerrainRenderMode::Cdlod)
+float cdlodLeafRangeScale = 4.0f;   // Leaf (full resolution) range, in chunk widths; each coarser level doubles it
+float cdlodMorphStartRatio = 0.67f; // Fraction of each level's distance band drawn before it starts morphing
+
+// Streaming settings (TerrainRenderMode::Streaming)
+int streamingLevels = 6;            // Tile levels; each is twice as coarse as the one below
+int streamingRadius = 2;            // Coarsest-level tiles kept around camera.Target in each direction
+float streamingRefineRange = 1.0f;  // A tile is replaced by its four children within this many tile widths of camera.Target
+
+// Skip chunk-grid draws (Cdlod, HeightTexture, VertexBuffer) hidden behind nearer terrain
+bool horizonCulling = true;
+
+// Quadric-error decimation of each chunk's mesh (TerrainRenderMode::VertexBuffer): the largest
+// vertical error allowed, in unit-amplitude heights like the generated ones; 0 draws the full grid.
+// Set from the UI, only while the worker is idle.
+float decimationMaxError = 0.0f;
 
 float waterLevel = 0.5f;         // Initial water level
 unsigned int waterVAO, waterVBO; // Water plane buffers
 
 unsigned int VAO, VBO, EBO;
+unsigned int heightTexture;  // Terrain heights for TerrainRenderMode::HeightTexture and Cdlod
+unsigned int clipmapTexture; // One layer of ring heights per clipmap level (TerrainRenderMode::Clipmap)
+unsigned int tileTexture;    // One layer of heights per tile cache slot (TerrainRenderMode::Streaming)
+
+// Grid and chunk layout of the terrain currently on the GPU. Drawing uses this rather than
+// terrainChunks, which is lent to the LLM worker while a command is pending.
+struct TerrainGpuGrid
+{
+    int width = 0;
+    int height = 0;
+    float spacing = 0.0f;
+    float originX = 0.0f;
+    float originZ = 0.0f;
+    std::vector<TerrainChunks::Extent> chunks;
+    std::vector<glm::vec2> chunkHeights; // (min, max) unit-amplitude height of each chunk
+    glm::vec2 compactHeightRange = glm::vec2(0.0f); // (min, max) unit-amplitude height compact vertices are quantized over
+    std::vector<unsigned short> decimatedIndices; // Every decimated chunk's triangle list, stored in the EBO after the shared patch indices
+    std::vector<glm::ivec3> chunkIndexRanges;     // (first, count, capacity) of each chunk's list in decimatedIndices; count 0 draws the shared patch
+    size_t decimatedWaste = 0;                    // Indices of decimatedIndices no chunk's range holds any more
+    size_t decimatedIndicesOnGpu = 0;             // Room for decimated indices in the EBO
+};
+TerrainGpuGrid terrainGpuGrid;
+
+// A frustum-visible chunk-grid draw as seen by the horizon culler
+struct HorizonDraw
+{
+    glm::vec3 boxMin;    // Bounds of everything the draw renders
+    glm::vec3 boxMax;
+    glm::ivec4 chunks;   // Chunks covered: first x, first z, last x, last z
+    bool fullResolution; // Draws exactly one chunk's own vertices, so that chunk can occlude
+};
+
+// GPU time of the terrain draws, averaged over a fixed number of frames and shown in the UI so
+// the index formats can be compared. Results are read a frame or more late, and only once the
+// GPU reports them available, so the CPU never waits on them.
+struct TerrainDrawTimer
+{
+    static constexpr int frames = 120; // Frames per average
+    unsigned int queries[2] = {0, 0};  // Alternate between frames
+    bool pending[2] = {false, false};
+    bool running = false;              // A query was begun this frame
+    int frame = 0;
+    int samples = 0;
+    double totalMilliseconds = 0.0;
+    double averageMilliseconds = 0.0;  // Latest complete average; 0 until there is one
+};
+TerrainDrawTimer terrainDrawTimer;
+bool terrainDrawTiming = false; // Time the terrain draws (toggled in the UI)
+
+// Quadtree over the chunks on the GPU, and the nodes selected for the current frame
+CdlodQuadtree cdlodQuadtree;
+std::vector<CdlodQuadtree::Selection> cdlodSelection;
 
 // Global Variables
 ArcballCamera camera(glm::vec3(0.0f, 0.5f, 0.0f), 2.0f, -90.0f, -20.0f);
-PerlinNoise perlin;
+PerlinNoise perlin; // Read-only after construction, shared by all generation threads
+ThreadPool threadPool;
+OctaveLayerCache octaveLayerCache(perlin, threadPool);
+GeometryClipmap terrainClipmap(perlin, threadPool); // Main thread only
+TerrainTileCache terrainTileCache(perlin, threadPool); // Main thread only; tiles are generated on the pool
+std::vector<TerrainTileCache::Draw> streamingDraws;    // Tiles selected for the current frame
+FrustumCuller frustumCuller;                           // Bounds of the current frame's candidate draws
+std::vector<int> visibleDraws;                         // Indices of the candidates inside the view frustum
+HorizonCuller horizonCuller;                           // Screen-column horizon of the current frame
+std::vector<HorizonDraw> horizonDraws;                 // The frustum-visible draws, as seen by horizonCuller
+std::mutex terrainGenerationMutex; // Serializes generateAdvancedTerrain (it updates octaveLayerCache)
+std::atomic<int> terrainGenerationTotal(0); // Chunks the running generateAdvancedTerrain regenerates; 0 when idle
+std::atomic<int> terrainGenerationDone(0);  // Of those, chunks finished so far
+std::atomic<int> terrainGenerationStep(1);  // Grid step of the level being generated; above 1 for a preview
 bool leftMousePressed = false;
+bool indexFormatKeyPressed = false;
 bool rightMousePressed = false;
 float lastX = 400.0f, lastY = 300.0f;
 
+// TerrainParameters structure
+struct TerrainParameters
+{
+    int numOctaves;
+    float persistence;
+    float lacunarity;
+    float baseAmplitude;
+    float baseFrequency;
+    int resolution; // Vertices along each side of the grid
+};
+
+// GPU terrain storage of one grid layout that is not being drawn: a height texture or a vertex
+// buffer, depending on the render mode
+struct SpareTerrainStorage
+{
+    int width;
+    int height;
+    float spacing;
+    float originX;
+    float originZ;
+    unsigned int heightTexture;
+    unsigned int vertexBuffer;
+    glm::vec2 compactHeightRange; // Its compact vertices' quantization range
+    std::vector<size_t> lacking; // Chunks the upload that replaced it wrote, if of the same layout
+};
+
+// A terrain upload spread over several frames by setupBuffers. It never writes the storage being
+// drawn, but spare storage of the same layout if there is one, and new storage otherwise. That
+// storage and the upload's grid (chunk height ranges included) are swapped in once complete, so
+// the previous terrain is drawn, whole, until then. Replaced storage is kept as a spare while its
+// layout is the drawn one or a progressive refinement level of it (or the other way round), so an
+// edit allocates no GPU memory once its resolution has been seen.
+struct TerrainUpload
+{
+    bool active = false;
+    bool newLayout = false;
+    std::vector<size_t> chunks;     // Chunks to upload, in chunk order
+    std::vector<size_t> indexChunks; // Chunks whose decimated index lists changed, in chunk order
+    size_t next = 0;                // First of them not uploaded yet
+    int failedUnmaps = 0;           // Vertex buffer contents lost while mapped (the upload restarts once)
+    unsigned int heightTexture = 0; // The storage being written
+    unsigned int vertexBuffer = 0;
+    TerrainGpuGrid grid;            // Swapped into terrainGpuGrid once complete
+    std::vector<SpareTerrainStorage> spares;
+};
+TerrainUpload terrainUpload;
+float terrainUploadBudgetMilliseconds = 4.0f; // Main-thread time spent uploading terrain per frame
+
+// Progressive refinement of edits (Cdlod, HeightTexture, VertexBuffer): while the full grid is
+// generated, previews at every power-of-two fraction of its resolution, starting from the first
+// with at most coarsestPreviewQuads quads a side, are drawn, each as soon as it is ready
+int coarsestPreviewQuads = 256;                // Keeps the first preview as quick at any resolution
+int progressiveRefinementMinResolution = 1024; // Smaller grids are generated in a few milliseconds anyway
+
 // Function Prototypes
 void processInput(GLFWwindow *window);
 void mouse_callback(GLFWwindow *window, double xpos, double ypos);
 void mouse_button_callback(GLFWwindow *window, int button, int action, int mods);
 void scroll_callback(GLFWwindow *window, double xOffset, double yOffset);
-void generateAdvancedTerrain(int width, int height, std::vector<float> &vertices, std::vector<unsigned int> &indices, std::vector<float> &normals);
-unsigned int createShaderProgram();
+void generateAdvancedTerrain(int width, int height, const TerrainParameters &params, TerrainChunks &chunks, int step = 1,
+                             const TerrainChunks *coarser = nullptr);
+bool terrainLayersCached(int width, int height, const TerrainParameters &params);
+void decimateTerrainChunk(HeightfieldDecimator &decimator, VertexCacheOptimizer &optimizer, TerrainChunks::Chunk &chunk);
+void decimateTerrainChunks(TerrainChunks &chunks);
+void buildTerrainIndices(std::vector<unsigned short> &indices, bool skirts = false, TerrainIndexFormat format = TerrainIndexFormat::TriangleList);
+void writeChunkVertices(const TerrainChunks &chunks, const TerrainChunks::Chunk &chunk, const PerlinNoise::Octaves &octaves, float *vertices);
+void writeCompactChunkVertices(const TerrainChunks &chunks, const TerrainChunks::Chunk &chunk, const PerlinNoise::Octaves &octaves,
+                               const glm::vec2 &heightRange, CompactTerrainVertex *vertices);
+glm::vec3 chunkVertexNormal(const TerrainChunks &chunks, const TerrainChunks::Chunk &chunk, const PerlinNoise::Octaves &octaves, int x, int z);
+void encodeOctahedralNormal(const glm::vec3 &normal, signed char encoded[2]);
+glm::vec3 centralDifferenceNormal(const Heightfield &heights, int x, int z);
+glm::vec3 triangleAverageNormal(const Heightfield &heights, int x, int z);
+glm::vec3 analyticNormal(const PerlinNoise::Octaves &octaves, float x, float z);
+unsigned int createShaderProgram(TerrainRenderMode renderMode, bool compactVertices);
 unsigned int loadTexture(const char *path);
-void setupBuffers(unsigned int &VAO, unsigned int &VBO, unsigned int &EBO, const std::vector<float> &vertices, const std::vector<float> &normals, const std::vector<unsigned int> &indices);
+bool setupBuffers(unsigned int &VAO, unsigned int &VBO, unsigned int &EBO, TerrainChunks &chunks, const TerrainParameters &params,
+                  const std::vector<unsigned short> &indices, float budgetMilliseconds = 0.0f);
+bool writeChunkVertexSlots(unsigned int buffer, TerrainChunks &chunks, const TerrainParameters &params, const glm::vec2 &heightRange,
+                           const size_t *chunkIndices, size_t count);
+bool isRefinementLevel(int coarseWidth, int coarseHeight, float coarseSpacing, int fineWidth, int fineHeight, float fineSpacing);
+void bindTerrainVertexAttributes(unsigned int VAO, unsigned int buffer);
+unsigned int createHeightTexture(int width, int height);
+void uploadTerrainIndices(unsigned int VAO, unsigned int EBO, const std::vector<unsigned short> &indices);
+void uploadDecimatedIndices(unsigned int VAO, unsigned int EBO, const TerrainChunks &chunks, const std::vector<size_t> &changed,
+                            const std::vector<unsigned short> &indices);
+void beginTerrainDrawTiming(TerrainDrawTimer &timer);
+void endTerrainDrawTiming(TerrainDrawTimer &timer);
+void resetTerrainDrawTiming(TerrainDrawTimer &timer);
+void uploadHeightTexture(unsigned int texture, const TerrainChunks &chunks, const size_t *chunkIndices, size_t count);
+void updateClipmap(GeometryClipmap &clipmap, unsigned int &texture, const glm::vec3 &center);
+void updateStreamingTiles(TerrainTileCache &cache, unsigned int &texture, const glm::vec3 &center, std::vector<TerrainTileCache::Draw> &draws);
+void addChunkBounds(FrustumCuller &culler, const TerrainGpuGrid &grid, float heightScale);
+void cullHiddenChunks(const glm::mat4 &mvp, const glm::vec3 &eye, float heightScale, std::vector<int> &visible);
+void cullHiddenDraws(HorizonCuller &culler, const glm::mat4 &mvp, const glm::vec3 &eye, const TerrainGpuGrid &grid, float heightScale,
+                     const std::vector<HorizonDraw> &draws, std::vector<int> &visible);
 void checkOpenGLError();
 unsigned int compileShader(const char *shaderSource, GLenum shaderType);
 unsigned int loadCubemap(std::vector<std::string> faces);
@@ -77,56 +319,80 @@ unsigned int createSkyboxShaderProgram();
 // Light position
 glm::vec3 lightPos(0.0f, 2.0f, 5.0f);
 
-// TerrainParameters structure
-struct TerrainParameters
-{
-    int numOctaves;
-    float persistence;
-    float lacunarity;
-    float baseAmplitude;
-    float baseFrequency;
-};
-
 // Stack to keep track of terrain parameter history for undo functionality
 std::stack<TerrainParameters> terrainStateHistory;
 
-void updateTerrain(int width, int height,
-                   std::vector<float>& vertices,
-                   std::vector<unsigned int>& indices,
-                   std::vector<float>& normals,
-                   int numOctaves,
-                   float persistence,
-                   float lacunarity,
-                   float baseAmplitude,
-                   float baseFrequency)
+// Snapshot of the global terrain parameters
+TerrainParameters currentTerrainParameters()
+{
+    return { ::numOctaves, ::persistence, ::lacunarity, ::baseAmplitude, ::baseFrequency, ::width };
+}
+
+// The mesh is generated at unit amplitude and scaled by the heightScale uniform, so only
+// changes to the other parameters need new heights
+bool requiresRegeneration(const TerrainParameters &from, const TerrainParameters &to)
+{
+    return from.numOctaves != to.numOctaves ||
+           from.persistence != to.persistence ||
+           from.lacunarity != to.lacunarity ||
+           from.baseFrequency != to.baseFrequency ||
+           from.resolution != to.resolution;
+}
+
+// Clipmap and Streaming generate their own heights around the camera (updateClipmap,
+// updateStreamingTiles) and take only the grid's spacing from terrainGpuGrid, so they never
+// generate or upload terrainChunks
+bool terrainChunksDrawn()
+{
+    return terrainRenderMode != TerrainRenderMode::Clipmap && terrainRenderMode != TerrainRenderMode::Streaming;
+}
+
+// The chunks being uploaded and drawn: a preview while the worker refines an edit, else terrainChunks
+TerrainChunks &drawnTerrainChunks()
+{
+    return terrainPreviewChunks ? *terrainPreviewChunks : terrainChunks;
+}
+
+// Lay out terrainGpuGrid for a resolution without any chunks, for modes that do not draw them
+void setTerrainGridLayout(int resolution)
+{
+    terrainGpuGrid.width = resolution;
+    terrainGpuGrid.height = resolution;
+    terrainGpuGrid.spacing = 2.0f / (resolution - 1);
+    terrainGpuGrid.originX = -0.5f;
+    terrainGpuGrid.originZ = -0.5f;
+}
+
+// Apply new parameters. If `regenerated`, drawnTerrainChunks() already holds the heights generated
+// for them and the changed chunks start uploading; otherwise it is unchanged (an amplitude-only
+// edit). An undo does not record the state it leaves.
+void updateTerrain(const TerrainParameters &newParams, bool regenerated, bool recordHistory = true)
 {
     // Save current state before changing
-    TerrainParameters currentParams = {
-        ::numOctaves,
-        ::persistence,
-        ::lacunarity,
-        ::baseAmplitude,
-        ::baseFrequency
-    };
-    terrainStateHistory.push(currentParams);
+    if (recordHistory)
+        terrainStateHistory.push(currentTerrainParameters());
 
     // Update global parameters
-    ::numOctaves = numOctaves;
-    ::persistence = persistence;
-    ::lacunarity = lacunarity;
-    ::baseAmplitude = baseAmplitude;
-    ::baseFrequency = baseFrequency;
-
-    // Clear existing data
-    vertices.clear();
-    indices.clear();
-    normals.clear();
-
-    // Generate terrain with new parameters
-    generateAdvancedTerrain(width, height, vertices, indices, normals);
+    ::numOctaves = newParams.numOctaves;
+    ::persistence = newParams.persistence;
+    ::lacunarity = newParams.lacunarity;
+    ::baseAmplitude = newParams.baseAmplitude;
+    ::baseFrequency = newParams.baseFrequency;
+    ::width = newParams.resolution;
+    ::height = newParams.resolution;
+
+    if (!terrainChunksDrawn())
+    {
+        // The next frame's update sees the new spacing and parameters and regenerates around the
+        // camera (the tile cache bumps its epoch, so tiles in flight are discarded)
+        setTerrainGridLayout(newParams.resolution);
+        return;
+    }
+    if (!regenerated)
+        return;
 
-    // Update buffers and reload data to GPU if necessary
-    setupBuffers(VAO, VBO, EBO, vertices, normals, indices);
+    // Upload the regenerated chunks, a slice per frame (continued from the render loop)
+    setupBuffers(VAO, VBO, EBO, drawnTerrainChunks(), newParams, indices, terrainUploadBudgetMilliseconds);
 }
 
 nlohmann::json functionDefinitions = nlohmann::json::array({
@@ -167,6 +433,12 @@ nlohmann::json functionDefinitions = nlohmann::json::array({
                             {"description", "Base frequency for terrain features (controls feature size)."},
                             {"minimum", 0.1},
                             {"maximum", 5.0}
+                        }},
+                        {"resolution", {
+                            {"type", "integer"},
+                            {"description", "Vertices along each side of the terrain mesh (controls mesh detail, not the shape of the features)."},
+                            {"minimum", 128},
+                            {"maximum", 8192}
                         }}
                     }},
                 {"required", nlohmann::json::array({"numOctaves", "persistence", "lacunarity", "baseAmplitude", "baseFrequency"})}
@@ -206,6 +478,7 @@ The terrain is generated using Perlin noise. The parameters you need to adjust b
 - lacunarity (Float): Controls the frequency increase between octaves. Higher values make the terrain features denser. Current value is )" + std::to_string(::lacunarity) + R"(.
 - baseAmplitude (Float): Determines the overall height variation. Higher values create taller hills. Current value is )" + std::to_string(::baseAmplitude) + R"(.
 - baseFrequency (Float): Controls the overall scale of the terrain features. Higher values make the features more frequent (smaller hills). Current value is )" + std::to_string(::baseFrequency) + R"(.
+- resolution (Integer, optional): Number of vertices along each side of the terrain mesh, from 128 to 8192. Higher values make a finer, more detailed mesh without changing the shape of the terrain; use it when the user asks for more mesh detail or a smoother-looking surface. Current value is )" + std::to_string(::width) + R"(.
 
 Remember the user's previous instructions and adjust parameters accordingly. If the user wants to revert changes or extend on previous commands, handle that appropriately.
 
@@ -318,71 +591,339 @@ nlohmann::json parseOpenAIResponse(const std::string& response)
     }
 }
 
-void invokeTerrainFunction(const nlohmann::json& functionCall)
+// Turn an updateTerrain function call into clamped parameters relative to `current`
+TerrainParameters resolveTerrainFunction(const nlohmann::json& functionCall, const TerrainParameters& current)
 {
     std::string functionName = functionCall["function_name"];
     nlohmann::json args = functionCall["arguments"];
 
-    if (functionName == "updateTerrain")
-    {
-        // Extract parameters with default values
-        int newNumOctaves = args.value("numOctaves", ::numOctaves);
-        float newPersistence = args.value("persistence", ::persistence);
-        float newLacunarity = args.value("lacunarity", ::lacunarity);
-        float newBaseAmplitude = args.value("baseAmplitude", ::baseAmplitude);
-        float newBaseFrequency = args.value("baseFrequency", ::baseFrequency);
-
-        // Limit the changes to reasonable amounts
-        int deltaNumOctaves = newNumOctaves - ::numOctaves;
-        if (deltaNumOctaves > 2) newNumOctaves = ::numOctaves + 2;
-        if (deltaNumOctaves < -2) newNumOctaves = ::numOctaves - 2;
-
-        float deltaPersistence = newPersistence - ::persistence;
-        if (deltaPersistence > 0.2f) newPersistence = ::persistence + 0.2f;
-        if (deltaPersistence < -0.2f) newPersistence = ::persistence - 0.2f;
-
-        float deltaLacunarity = newLacunarity - ::lacunarity;
-        if (deltaLacunarity > 0.5f) newLacunarity = ::lacunarity + 0.5f;
-        if (deltaLacunarity < -0.5f) newLacunarity = ::lacunarity - 0.5f;
-
-        float deltaBaseAmplitude = newBaseAmplitude - ::baseAmplitude;
-        if (deltaBaseAmplitude > 0.5f) newBaseAmplitude = ::baseAmplitude + 0.5f;
-        if (deltaBaseAmplitude < -0.5f) newBaseAmplitude = ::baseAmplitude - 0.5f;
-
-        float deltaBaseFrequency = newBaseFrequency - ::baseFrequency;
-        if (deltaBaseFrequency > 0.5f) newBaseFrequency = ::baseFrequency + 0.5f;
-        if (deltaBaseFrequency < -0.5f) newBaseFrequency = ::baseFrequency - 0.5f;
-
-        // Ensure parameters are within valid ranges
-        newNumOctaves = std::clamp(newNumOctaves, 1, 10);
-        newPersistence = std::clamp(newPersistence, 0.1f, 1.0f);
-        newLacunarity = std::clamp(newLacunarity, 1.0f, 4.0f);
-        newBaseAmplitude = std::clamp(newBaseAmplitude, 0.1f, 5.0f);
-        newBaseFrequency = std::clamp(newBaseFrequency, 0.1f, 5.0f);
-
-        // Call the updateTerrain function
-        updateTerrain(width, height, vertices, indices, normals,
-                      newNumOctaves, newPersistence, newLacunarity,
-                      newBaseAmplitude, newBaseFrequency);
-
-        // Prepare a string with the updated parameter values
-        std::ostringstream oss;
-        oss << "Assistant: Terrain parameters updated.\n\n";
-        oss << "Current Terrain Parameters:\n\n";
-        oss << "Number of Octaves: " << ::numOctaves << "\n";
-        oss << "Persistence: " << ::persistence << "\n";
-        oss << "Lacunarity: " << ::lacunarity << "\n";
-        oss << "Base Amplitude: " << ::baseAmplitude << "\n";
-        oss << "Base Frequency: " << ::baseFrequency << "\n";
-
-        // Append the parameter values to the chat history
-        chatHistory.append(oss.str().c_str());
-        scrollToBottom = true;
+    if (functionName != "updateTerrain")
+    {
+        throw std::runtime_error("Unknown function called: " + functionName);
     }
 
-    else
+    // Extract parameters with default values
+    int newNumOctaves = args.value("numOctaves", current.numOctaves);
+    float newPersistence = args.value("persistence", current.persistence);
+    float newLacunarity = args.value("lacunarity", current.lacunarity);
+    float newBaseAmplitude = args.value("baseAmplitude", current.baseAmplitude);
+    float newBaseFrequency = args.value("baseFrequency", current.baseFrequency);
+    int newResolution = args.value("resolution", current.resolution);
+
+    // Limit the changes to reasonable amounts
+    int deltaNumOctaves = newNumOctaves - current.numOctaves;
+    if (deltaNumOctaves > 2) newNumOctaves = current.numOctaves + 2;
+    if (deltaNumOctaves < -2) newNumOctaves = current.numOctaves - 2;
+
+    float deltaPersistence = newPersistence - current.persistence;
+    if (deltaPersistence > 0.2f) newPersistence = current.persistence + 0.2f;
+    if (deltaPersistence < -0.2f) newPersistence = current.persistence - 0.2f;
+
+    float deltaLacunarity = newLacunarity - current.lacunarity;
+    if (deltaLacunarity > 0.5f) newLacunarity = current.lacunarity + 0.5f;
+    if (deltaLacunarity < -0.5f) newLacunarity = current.lacunarity - 0.5f;
+
+    float deltaBaseAmplitude = newBaseAmplitude - current.baseAmplitude;
+    if (deltaBaseAmplitude > 0.5f) newBaseAmplitude = current.baseAmplitude + 0.5f;
+    if (deltaBaseAmplitude < -0.5f) newBaseAmplitude = current.baseAmplitude - 0.5f;
+
+    float deltaBaseFrequency = newBaseFrequency - current.baseFrequency;
+    if (deltaBaseFrequency > 0.5f) newBaseFrequency = current.baseFrequency + 0.5f;
+    if (deltaBaseFrequency < -0.5f) newBaseFrequency = current.baseFrequency - 0.5f;
+
+    // At most double or halve the mesh resolution
+    newResolution = std::clamp(newResolution, current.resolution / 2, current.resolution * 2);
+
+    // Ensure parameters are within valid ranges
+    TerrainParameters resolved;
+    resolved.numOctaves = std::clamp(newNumOctaves, 1, 10);
+    resolved.persistence = std::clamp(newPersistence, 0.1f, 1.0f);
+    resolved.lacunarity = std::clamp(newLacunarity, 1.0f, 4.0f);
+    resolved.baseAmplitude = std::clamp(newBaseAmplitude, 0.1f, 5.0f);
+    resolved.baseFrequency = std::clamp(newBaseFrequency, 0.1f, 5.0f);
+    resolved.resolution = std::clamp(newResolution, minTerrainResolution, maxTerrainResolution);
+    return resolved;
+}
+
+// Background LLM worker. The HTTP round trip, response parsing and terrain generation run
+// off the render thread; finished commands are queued and applied by the main thread.
+// Only one request is in flight at a time, so the worker owns conversationHistory while
+// llmRequestPending is set.
+// The request carries terrainChunks to the worker and the result hands it back, so
+// regeneration writes into memory allocated once per resolution. Changes that need no LLM call
+// (a resolution picked in the UI, an undo, a new decimation bound) go through the worker too, so that generating even
+// the largest grid never blocks the render thread. A large grid is refined coarse to fine: each
+// preview level is queued as a result of its own ahead of the final one, lending the level in
+// place: the main thread only uploads from it while the worker reads it for the next level.
+struct TerrainCommandRequest
+{
+    std::string userInput; // Sent to the LLM; empty for a direct change to targetParams
+    TerrainParameters currentParams;
+    TerrainParameters targetParams;
+    bool undo;
+    TerrainChunks chunks;
+    bool redecimate = false; // Only decimate the chunks again, at decimationMaxError
+};
+
+struct TerrainCommandResult
+{
+    std::string error; // Empty on success
+    TerrainParameters params;
+    bool regenerated = false; // False when only baseAmplitude changed
+    bool undo = false;        // Applied without recording history (an undo, or a new decimation)
+    bool preview = false;     // A coarse level of the edit; params.resolution is the level's
+    TerrainParameters previousParams; // The state the edit started from, recorded for undo
+    TerrainChunks chunks;
+    TerrainChunks *level = nullptr; // A preview's heights, owned by the worker and only read until the edit finishes
+};
+
+std::thread llmWorker;
+std::mutex llmMutex;
+std::condition_variable llmCondition;
+std::deque<TerrainCommandRequest> llmRequestQueue;
+std::deque<TerrainCommandResult> llmCompletionQueue;
+bool llmWorkerStopping = false;
+std::atomic<bool> llmRequestPending(false);
+
+void llmWorkerLoop()
+{
+    // Preview levels of progressive refinement, coarsest first; kept so their memory is reused.
+    // A deque, so the levels lent to the main thread stay put while finer ones are added.
+    std::deque<TerrainChunks> refinementLevels;
+
+    while (true)
+    {
+        TerrainCommandRequest request;
+        {
+            std::unique_lock<std::mutex> lock(llmMutex);
+            llmCondition.wait(lock, [] { return llmWorkerStopping || !llmRequestQueue.empty(); });
+            if (llmWorkerStopping)
+                return;
+
+            request = std::move(llmRequestQueue.front());
+            llmRequestQueue.pop_front();
+        }
+
+        TerrainCommandResult result;
+        result.params = request.currentParams;
+        result.previousParams = request.currentParams;
+        result.undo = request.undo || request.redecimate;
+        result.chunks.swap(request.chunks);
+
+        if (request.redecimate)
+        {
+            if (terrainChunksDrawn())
+            {
+                decimateTerrainChunks(result.chunks);
+                result.regenerated = true;
+            }
+            std::lock_guard<std::mutex> lock(llmMutex);
+            llmCompletionQueue.push_back(std::move(result));
+            continue;
+        }
+
+        // Send the user input to OpenAI for processing
+        std::string response = request.userInput.empty() ? std::string() : sendOpenAIRequest(request.userInput);
+
+        // Parse the function call and generate the terrain it asks for
+        if (!request.userInput.empty() && response.empty())
+        {
+            result.error = "Request to the language model failed";
+        }
+        else
+        {
+            try
+            {
+                if (request.userInput.empty())
+                    result.params = request.targetParams;
+                else
+                    result.params = resolveTerrainFunction(parseOpenAIResponse(response), request.currentParams);
+
+                if (requiresRegeneration(request.currentParams, result.params) && terrainChunksDrawn())
+                {
+                    const int resolution = result.params.resolution;
+
+                    // Refine large grids coarse to fine, unless the heights are only a weighted sum of
+                    // cached octave layers, which is fast at any resolution
+                    int step = 1;
+                    while ((resolution - 1 + step - 1) / step > coarsestPreviewQuads)
+                        step *= 2;
+                    if (resolution < progressiveRefinementMinResolution || terrainLayersCached(resolution, resolution, result.params))
+                        step = 1;
+
+                    // Each level reuses the samples of the one before it; so does the full grid, unless
+                    // its octave layers are being cached (see generateAdvancedTerrain)
+                    const TerrainChunks *coarser = nullptr;
+                    for (size_t level = 0; step > 1; ++level, step /= 2)
+                    {
+                        if (refinementLevels.size() <= level)
+                            refinementLevels.emplace_back();
+                        TerrainChunks &levelChunks = refinementLevels[level];
+                        levelChunks.markAllDirty();
+                        generateAdvancedTerrain(resolution, resolution, result.params, levelChunks, step, coarser);
+                        coarser = &levelChunks;
+
+                        TerrainCommandResult preview;
+                        preview.params = result.params;
+                        preview.params.resolution = levelChunks.width();
+                        preview.regenerated = true;
+                        preview.preview = true;
+                        preview.level = &levelChunks;
+
+                        std::lock_guard<std::mutex> lock(llmMutex);
+                        llmCompletionQueue.push_back(std::move(preview));
+                    }
+
+                    // New noise parameters change every sample (a new resolution re-chunks the grid anyway)
+                    result.chunks.markAllDirty();
+                    generateAdvancedTerrain(resolution, resolution, result.params, result.chunks, 1, coarser);
+                    result.regenerated = true;
+                }
+            }
+            catch (const std::exception& e)
+            {
+                result.error = e.what();
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(llmMutex);
+        llmCompletionQueue.push_back(std::move(result));
+    }
+}
+
+void startLlmWorker()
+{
+    llmWorker = std::thread(llmWorkerLoop);
+}
+
+void stopLlmWorker()
+{
     {
-        std::cerr << "Unknown function called: " << functionName << std::endl;
+        std::lock_guard<std::mutex> lock(llmMutex);
+        llmWorkerStopping = true;
+    }
+    llmCondition.notify_all();
+    if (llmWorker.joinable())
+        llmWorker.join();
+}
+
+void submitTerrainCommand(const std::string& userInput)
+{
+    llmRequestPending = true;
+    {
+        std::lock_guard<std::mutex> lock(llmMutex);
+        llmRequestQueue.push_back({ userInput, currentTerrainParameters(), currentTerrainParameters(), false, TerrainChunks() });
+        llmRequestQueue.back().chunks.swap(terrainChunks);
+    }
+    llmCondition.notify_one();
+}
+
+// Queue a change to `params` that needs no LLM call; it is generated on the worker like a command
+void submitTerrainChange(const TerrainParameters& params, bool undo)
+{
+    llmRequestPending = true;
+    {
+        std::lock_guard<std::mutex> lock(llmMutex);
+        llmRequestQueue.push_back({ std::string(), currentTerrainParameters(), params, undo, TerrainChunks() });
+        llmRequestQueue.back().chunks.swap(terrainChunks);
+    }
+    llmCondition.notify_one();
+}
+
+// Decimate the terrain again after decimationMaxError changed; the heights stay as they are
+void submitTerrainRedecimation()
+{
+    llmRequestPending = true;
+    {
+        std::lock_guard<std::mutex> lock(llmMutex);
+        llmRequestQueue.push_back({ std::string(), currentTerrainParameters(), currentTerrainParameters(), false, TerrainChunks(), true });
+        llmRequestQueue.back().chunks.swap(terrainChunks);
+    }
+    llmCondition.notify_one();
+}
+
+// terrainChunks is lent to the worker, or still being uploaded
+bool terrainBusy()
+{
+    return llmRequestPending || terrainUpload.active;
+}
+
+// Called once per frame on the main thread: applies finished commands and uploads their terrain.
+// A preview is uploaded whole before the next level of the edit replaces it.
+void processTerrainCommandCompletions()
+{
+    if (terrainUpload.active)
+        return;
+
+    std::deque<TerrainCommandResult> completed;
+    {
+        std::lock_guard<std::mutex> lock(llmMutex);
+        completed.swap(llmCompletionQueue);
+    }
+
+    for (size_t i = 0; i < completed.size(); ++i)
+    {
+        TerrainCommandResult& result = completed[i];
+
+        // A finer level (or the finished terrain) has already arrived
+        if (result.preview && i + 1 < completed.size())
+            continue;
+
+        if (result.preview)
+        {
+            // Drawn from the worker's level in place; terrainChunks is still lent out
+            terrainPreviewChunks = result.level;
+            // The request is still pending, and only the finished edit goes into the history
+            updateTerrain(result.params, true, false);
+            continue;
+        }
+
+        // Take the chunks back, whatever the outcome; the worker may reuse its levels from now on
+        terrainChunks.swap(result.chunks);
+        terrainPreviewChunks = nullptr;
+
+        // An edit that failed after its previews were drawn has applied their parameters, and
+        // terrainChunks may be half generated: the state it started from is generated again
+        bool restorePrevious = false;
+        if (!result.error.empty())
+        {
+            chatHistory.append("Assistant: Error - ");
+            chatHistory.append(result.error.c_str());
+            chatHistory.append("\n");
+            restorePrevious = requiresRegeneration(currentTerrainParameters(), result.previousParams);
+        }
+        else if (result.undo)
+        {
+            // undoTerrainChange has already reported it, and a new decimation is not an edit
+            updateTerrain(result.params, result.regenerated, false);
+        }
+        else
+        {
+            // Previews have changed the parameters already, so record the ones the edit started from
+            terrainStateHistory.push(result.previousParams);
+            updateTerrain(result.params, result.regenerated, false);
+
+            // Prepare a string with the updated parameter values
+            std::ostringstream oss;
+            oss << "Assistant: Terrain parameters updated.\n\n";
+            oss << "Current Terrain Parameters:\n\n";
+            oss << "Number of Octaves: " << ::numOctaves << "\n";
+            oss << "Persistence: " << ::persistence << "\n";
+            oss << "Lacunarity: " << ::lacunarity << "\n";
+            oss << "Base Amplitude: " << ::baseAmplitude << "\n";
+            oss << "Base Frequency: " << ::baseFrequency << "\n";
+            oss << "Resolution: " << ::width << " x " << ::height << "\n";
+
+            // Append the parameter values to the chat history
+            chatHistory.append(oss.str().c_str());
+        }
+
+        scrollToBottom = true;
+        resolutionInputOutdated = true;
+        llmRequestPending = false;
+
+        if (restorePrevious)
+            submitTerrainChange(result.previousParams, true);
     }
 }
 
@@ -393,21 +934,11 @@ void undoTerrainChange()
         TerrainParameters previousParams = terrainStateHistory.top();
         terrainStateHistory.pop();
 
-        // Update parameters to previous state
-        ::numOctaves = previousParams.numOctaves;
-        ::persistence = previousParams.persistence;
-        ::lacunarity = previousParams.lacunarity;
-        ::baseAmplitude = previousParams.baseAmplitude;
-        ::baseFrequency = previousParams.baseFrequency;
-
-        // Regenerate the terrain
-        vertices.clear();
-        indices.clear();
-        normals.clear();
-        generateAdvancedTerrain(width, height, vertices, indices, normals);
-
-        // Update buffers and reload data to GPU if necessary
-        setupBuffers(VAO, VBO, EBO, vertices, normals, indices);
+        // Regenerate the terrain on the worker; reverting an amplitude edit only changes the heightScale uniform
+        if (requiresRegeneration(currentTerrainParameters(), previousParams))
+            submitTerrainChange(previousParams, true);
+        else
+            updateTerrain(previousParams, false, false);
 
         // Provide feedback to the user
         chatHistory.append("Assistant: Reverted to previous terrain state.\n");
@@ -435,6 +966,42 @@ void initImGui(GLFWwindow* window) {
     ImGui_ImplOpenGL3_Init("#version 330");
 }
 
+// Handle the text in inputBuffer: undo locally, everything else goes to the LLM worker
+void submitChatInput()
+{
+    // Append the user input to the chat history
+    chatHistory.append("User: ");
+    chatHistory.append(inputBuffer);
+    chatHistory.append("\n\n");
+
+    std::string userInput = std::string(inputBuffer);
+
+    // Check for undo command
+    if (userInput == "undo" || userInput == "revert")
+    {
+        undoTerrainChange();
+
+        // Optionally, add the undo command to the conversation history
+        conversationHistory.push_back({
+            {"role", "user"},
+            {"content", userInput}
+        });
+        conversationHistory.push_back({
+            {"role", "assistant"},
+            {"content", "Reverted to previous terrain state."}
+        });
+    }
+    else
+    {
+        // The response is handled by processTerrainCommandCompletions once it arrives
+        submitTerrainCommand(userInput);
+    }
+
+    // Clear input buffer after processing
+    strcpy(inputBuffer, "");
+    scrollToBottom = true;
+}
+
 // Function to render the ImGui chat interface
 void renderChatInterface() {
     // Start a new ImGui frame
@@ -449,9 +1016,19 @@ void renderChatInterface() {
     // Create chat interface window
     ImGui::Begin("Terrain Assistant", nullptr, ImGuiWindowFlags_NoCollapse);
 
-    // Chat history with scrollbar
-    ImGui::BeginChild("ChatHistory", ImVec2(0, -ImGui::GetFrameHeightWithSpacing()), true, ImGuiWindowFlags_HorizontalScrollbar);
+    // Chat history with scrollbar, above the input, resolution and decimation rows
+    ImGui::BeginChild("ChatHistory", ImVec2(0, -3.0f * ImGui::GetFrameHeightWithSpacing()), true, ImGuiWindowFlags_HorizontalScrollbar);
     ImGui::TextUnformatted(chatHistory.begin());
+    const int generationTotal = terrainGenerationTotal;
+    const int generationStep = terrainGenerationStep;
+    if (llmRequestPending && generationTotal > 0 && generationStep > 1)
+        ImGui::TextDisabled("Generating 1/%d resolution preview... %d%%", generationStep, 100 * terrainGenerationDone / generationTotal);
+    else if (llmRequestPending && generationTotal > 0)
+        ImGui::TextDisabled("Generating terrain... %d%%", 100 * terrainGenerationDone / generationTotal);
+    else if (llmRequestPending)
+        ImGui::TextDisabled("Assistant is thinking...");
+    else if (terrainUpload.active)
+        ImGui::TextDisabled("Uploading terrain... %d%%", (int)(100 * terrainUpload.next / std::max<size_t>(1, terrainUpload.chunks.size())));
     if (scrollToBottom)
         ImGui::SetScrollHereY(1.0f);  // Scroll to bottom if needed
     scrollToBottom = false;
@@ -462,118 +1039,68 @@ void renderChatInterface() {
 
     // Input text box
     ImGui::PushItemWidth(-40);
-    if (ImGui::InputText("##Input", inputBuffer, IM_ARRAYSIZE(inputBuffer), ImGuiInputTextFlags_EnterReturnsTrue))
-    {
-        if (strlen(inputBuffer) > 0)
-        {
-            // Append the user input to the chat history
-            chatHistory.append("User: ");
-            chatHistory.append(inputBuffer);
-            chatHistory.append("\n\n");
-
-            std::string userInput = std::string(inputBuffer);
-
-            // Check for undo command
-            if (userInput == "undo" || userInput == "revert")
-            {
-                undoTerrainChange();
-
-                // Optionally, add the undo command to the conversation history
-                conversationHistory.push_back({
-                    {"role", "user"},
-                    {"content", userInput}
-                });
-                conversationHistory.push_back({
-                    {"role", "assistant"},
-                    {"content", "Reverted to previous terrain state."}
-                });
-            }
-            else
-            {
-                // Send inputBuffer to OpenAI for processing
-                std::string response = sendOpenAIRequest(userInput);
-
-                // Parse and invoke terrain modification functions
-                if (!response.empty())
-                {
-                    try
-                    {
-                        nlohmann::json functionCall = parseOpenAIResponse(response);
-                        invokeTerrainFunction(functionCall);
-                    }
-                    catch (const std::exception& e)
-                    {
-                        chatHistory.append("Assistant: Error - ");
-                        chatHistory.append(e.what());
-                        chatHistory.append("\n");
-                        scrollToBottom = true;
-                    }
-                }
-            }
-
-            // Clear input buffer after processing
-            strcpy(inputBuffer, "");
-            scrollToBottom = true;
-        }
-    }
+    bool submitted = ImGui::InputText("##Input", inputBuffer, IM_ARRAYSIZE(inputBuffer), ImGuiInputTextFlags_EnterReturnsTrue);
     ImGui::PopItemWidth();
 
     // Send button
     ImGui::SameLine();
-    if (ImGui::Button("Send"))
-    {
-        if (strlen(inputBuffer) > 0)
-        {
-            // Append the user input to the chat history
-            chatHistory.append("User: ");
-            chatHistory.append(inputBuffer);
-            chatHistory.append("\n");
+    submitted |= ImGui::Button("Send");
 
-            std::string userInput = std::string(inputBuffer);
+    // Input typed while a request is pending stays in the box until the model has answered
+    if (submitted && !terrainBusy() && strlen(inputBuffer) > 0)
+    {
+        submitChatInput();
+    }
 
-            // Check for undo command
-            if (userInput == "undo" || userInput == "revert")
-            {
-                undoTerrainChange();
-
-                // Optionally, add the undo command to the conversation history
-                conversationHistory.push_back({
-                    {"role", "user"},
-                    {"content", userInput}
-                });
-                conversationHistory.push_back({
-                    {"role", "assistant"},
-                    {"content", "Reverted to previous terrain state."}
-                });
-            }
-            else
-            {
-                // Send inputBuffer to OpenAI for processing
-                std::string response = sendOpenAIRequest(userInput);
+    // Mesh resolution, generated in the background like a command
+    static int resolutionInput = ::width;
+    if (resolutionInputOutdated)
+        resolutionInput = ::width;
+    resolutionInputOutdated = false;
+    ImGui::PushItemWidth(120);
+    ImGui::InputInt("Resolution", &resolutionInput, 128, 1024);
+    ImGui::PopItemWidth();
+    resolutionInput = std::clamp(resolutionInput, minTerrainResolution, maxTerrainResolution);
+    ImGui::SameLine();
+    if (ImGui::Button("Apply") && !terrainBusy() && resolutionInput != ::width)
+    {
+        TerrainParameters params = currentTerrainParameters();
+        params.resolution = resolutionInput;
+        submitTerrainChange(params, false);
+    }
 
-                // Parse and invoke terrain modification functions
-                if (!response.empty())
-                {
-                    try
-                    {
-                        nlohmann::json functionCall = parseOpenAIResponse(response);
-                        invokeTerrainFunction(functionCall);
-                    }
-                    catch (const std::exception& e)
-                    {
-                        chatHistory.append("Assistant: Error - ");
-                        chatHistory.append(e.what());
-                        chatHistory.append("\n");
-                        scrollToBottom = true;
-                    }
-                }
-            }
+    // GPU time of the terrain draws, for comparing the index formats (I)
+    ImGui::SameLine();
+    if (ImGui::Checkbox("Time draws", &terrainDrawTiming))
+        resetTerrainDrawTiming(terrainDrawTimer);
+    if (terrainDrawTiming && terrainDrawTimer.averageMilliseconds > 0.0)
+    {
+        ImGui::SameLine();
+        ImGui::TextDisabled("%.3f ms (%s)", terrainDrawTimer.averageMilliseconds,
+                            terrainIndexFormat == TerrainIndexFormat::TriangleStrip ? "strips" : "lists");
+    }
 
-            // Clear input buffer after processing
-            strcpy(inputBuffer, "");
-            scrollToBottom = true;
+    // Decimation error bound, applied to every chunk once the slider is let go
+    static float decimationInput = decimationMaxError;
+    if (terrainRenderMode == TerrainRenderMode::VertexBuffer)
+    {
+        ImGui::PushItemWidth(120);
+        ImGui::SliderFloat("Max error", &decimationInput, 0.0f, 0.01f, decimationInput > 0.0f ? "%.4f" : "off");
+        ImGui::PopItemWidth();
+        if (ImGui::IsItemDeactivatedAfterEdit() && !terrainBusy() && decimationInput != decimationMaxError)
+        {
+            decimationMaxError = decimationInput;
+            submitTerrainRedecimation();
+        }
+        else if (!ImGui::IsItemActive())
+        {
+            decimationInput = decimationMaxError;
         }
     }
+    else
+    {
+        ImGui::TextDisabled("Decimation: VertexBuffer render mode only");
+    }
 
     ImGui::End(); // End of chat interface
 
@@ -633,6 +1160,21 @@ int main()
     // Configure Global OpenGL State
     glEnable(GL_DEPTH_TEST);
 
+    // The height texture holds the grid plus an apron on each side
+    GLint maxTextureSize = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
+    maxTerrainResolution = std::min(maxTerrainResolution, (int)maxTextureSize - 2 * TerrainChunks::apron);
+
+    if (terrainNormalMode != NormalMode::CentralDifference && terrainRenderMode != TerrainRenderMode::VertexBuffer)
+    {
+        std::cout << "TriangleAverage and Analytic normals need TerrainRenderMode::VertexBuffer; using CentralDifference" << std::endl;
+        terrainNormalMode = NormalMode::CentralDifference;
+    }
+
+    // Separates the rows of strip-form terrain indices; lists never contain the restart index
+    glEnable(GL_PRIMITIVE_RESTART);
+    glPrimitiveRestartIndex(terrainRestartIndex);
+
     // Load Textures
     unsigned int grassTexture = loadTexture("../resources/textures/grass.png");
     unsigned int rockTexture = loadTexture("../resources/textures/rock.png");
@@ -715,24 +1257,59 @@ int main()
     glUniform1i(glGetUniformLocation(skyboxShaderProgram, "skybox"), 0); // Set the skybox sampler uniform
 
     // Generate Advanced Terrain Grid
-    generateAdvancedTerrain(width, height, vertices, indices, normals);
-
-    std::cout << "Vertices generated: " << vertices.size() << std::endl;
-    std::cout << "Normals generated: " << normals.size() << std::endl;
-    std::cout << "Indices generated: " << indices.size() << std::endl;
+    if (terrainChunksDrawn())
+        generateAdvancedTerrain(width, height, currentTerrainParameters(), terrainChunks);
+    else
+        setTerrainGridLayout(width);
+    if (terrainRenderMode == TerrainRenderMode::Clipmap)
+        GeometryClipmap::buildIndices(indices, vertexCacheOptimization);
+    else
+        buildTerrainIndices(indices, terrainRenderMode == TerrainRenderMode::Streaming, terrainIndexFormat);
+
+    std::cout << "Chunks generated: " << terrainChunks.size() << std::endl;
+    std::cout << "Indices generated: " << indices.size() << " (" << indices.size() * sizeof(unsigned short) << " bytes)" << std::endl;
+    std::cout << "Vertex cache misses per triangle (ACMR): "
+              << VertexCacheOptimizer::averageCacheMissRatio(indices.data(), indices.size(),
+                                                             terrainIndexFormat == TerrainIndexFormat::TriangleStrip &&
+                                                                 terrainRenderMode != TerrainRenderMode::Clipmap,
+                                                             terrainRestartIndex)
+              << std::endl;
+    if (terrainRenderMode == TerrainRenderMode::VertexBuffer && decimationMaxError > 0.0f)
+    {
+        size_t gridTriangles = 0, decimatedTriangles = 0;
+        double decimatedMisses = 0.0;
+        for (size_t i = 0; i < terrainChunks.size(); ++i)
+        {
+            const TerrainChunks::Chunk &chunk = terrainChunks.chunk(i);
+            gridTriangles += (size_t)chunk.extent.quadsX * chunk.extent.quadsZ * 2;
+            decimatedTriangles += chunk.decimatedIndices.size() / 3;
+            decimatedMisses += VertexCacheOptimizer::averageCacheMissRatio(chunk.decimatedIndices.data(), chunk.decimatedIndices.size(), false,
+                                                                           terrainRestartIndex) *
+                               (chunk.decimatedIndices.size() / 3);
+        }
+        std::cout << "Decimated triangles: " << decimatedTriangles << " of " << gridTriangles
+                  << " (ACMR " << (decimatedTriangles > 0 ? decimatedMisses / decimatedTriangles : 0.0) << ")" << std::endl;
+    }
 
 
     // Create Shader Program
-    unsigned int shaderProgram = createShaderProgram();
+    unsigned int shaderProgram = createShaderProgram(terrainRenderMode, compactVertexFormat);
 
     // Set texture uniforms
     glUseProgram(shaderProgram);
     glUniform1i(glGetUniformLocation(shaderProgram, "grassTexture"), 0);
     glUniform1i(glGetUniformLocation(shaderProgram, "rockTexture"), 1);
     glUniform1i(glGetUniformLocation(shaderProgram, "snowTexture"), 2);
+    glUniform1i(glGetUniformLocation(shaderProgram, "heightMap"), 3);
+    glUniform1i(glGetUniformLocation(shaderProgram, "chunkPitch"), TerrainChunks::chunkVertices);
+    glUniform1i(glGetUniformLocation(shaderProgram, "clipmapHeights"), 3);
+    glUniform1i(glGetUniformLocation(shaderProgram, "tileHeights"), 3);
+    glUniform1i(glGetUniformLocation(shaderProgram, "clipmapSize"), GeometryClipmap::textureSize);
+    glUniform1i(glGetUniformLocation(shaderProgram, "ringVertices"), GeometryClipmap::ringVertices);
+    glUniform1f(glGetUniformLocation(shaderProgram, "morphWidth"), (float)GeometryClipmap::transitionWidth);
 
     // Setup Buffers
-    setupBuffers(VAO, VBO, EBO, vertices, normals, indices);
+    setupBuffers(VAO, VBO, EBO, terrainChunks, currentTerrainParameters(), indices);
 
     // Generate Water Plane
     std::vector<float> waterVertices;
@@ -752,11 +1329,21 @@ int main()
     // Initialize conversation history
     initializeConversationHistory();
 
+    // Start the background worker that talks to the LLM
+    startLlmWorker();
+
     // Main Render Loop
     while (!glfwWindowShouldClose(window))
     {
         glfwPollEvents();
 
+        // Apply any terrain commands the LLM worker has finished
+        processTerrainCommandCompletions();
+
+        // Continue uploading regenerated terrain, within a fixed time per frame
+        if (terrainUpload.active)
+            setupBuffers(VAO, VBO, EBO, drawnTerrainChunks(), currentTerrainParameters(), indices, terrainUploadBudgetMilliseconds);
+
         // Clear Screen
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
@@ -785,6 +1372,40 @@ int main()
         glActiveTexture(GL_TEXTURE2);
         glBindTexture(GL_TEXTURE_2D, snowTexture);
 
+        if (terrainRenderMode == TerrainRenderMode::Clipmap || terrainRenderMode == TerrainRenderMode::Streaming)
+        {
+            glActiveTexture(GL_TEXTURE3);
+            if (terrainRenderMode == TerrainRenderMode::Clipmap)
+            {
+                // Recentre the rings on the orbit target; only newly exposed strips are generated and uploaded
+                updateClipmap(terrainClipmap, clipmapTexture, camera.Target);
+                glBindTexture(GL_TEXTURE_2D_ARRAY, clipmapTexture);
+            }
+            else
+            {
+                // Upload finished tiles and pick what to draw; generation runs in the background
+                updateStreamingTiles(terrainTileCache, tileTexture, camera.Target, streamingDraws);
+                glBindTexture(GL_TEXTURE_2D_ARRAY, tileTexture);
+            }
+
+            // Terrain textures keep the scale they have on the chunked grid
+            glUniform2f(glGetUniformLocation(shaderProgram, "texCoordOrigin"), terrainGpuGrid.originX, terrainGpuGrid.originZ);
+            glUniform1f(glGetUniformLocation(shaderProgram, "texCoordScale"), 1.0f / (terrainGpuGrid.spacing * (terrainGpuGrid.width - 1)));
+        }
+        else
+        {
+            if (terrainRenderMode != TerrainRenderMode::VertexBuffer)
+            {
+                glActiveTexture(GL_TEXTURE3);
+                glBindTexture(GL_TEXTURE_2D, heightTexture);
+            }
+
+            // Grid the vertex shader rebuilds positions and texture coordinates from (not used by float vertices)
+            glUniform2i(glGetUniformLocation(shaderProgram, "gridSize"), terrainGpuGrid.width, terrainGpuGrid.height);
+            glUniform2f(glGetUniformLocation(shaderProgram, "gridOrigin"), terrainGpuGrid.originX, terrainGpuGrid.originZ);
+            glUniform1f(glGetUniformLocation(shaderProgram, "gridSpacing"), terrainGpuGrid.spacing);
+        }
+
         // View/Projection Transformations
         glm::mat4 view = camera.GetViewMatrix();
         glm::mat4 projection = glm::perspective(glm::radians(45.0f), 1920.0f / 1080.0f, 0.1f, 100.0f);
@@ -796,13 +1417,180 @@ int main()
         glUniformMatrix4fv(mvpLoc, 1, GL_FALSE, glm::value_ptr(mvp));
         glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
 
+        // Terrain heights are stored at unit amplitude
+        glUniform1f(glGetUniformLocation(shaderProgram, "heightScale"), baseAmplitude);
+
         // Pass Lighting Information to Shader
         glUniform3fv(glGetUniformLocation(shaderProgram, "lightPos"), 1, glm::value_ptr(lightPos));
         glUniform3fv(glGetUniformLocation(shaderProgram, "viewPos"), 1, glm::value_ptr(camera.GetCameraPosition()));
 
-        // Bind VAO and Draw the Grid
+        // Bind VAO and draw, always with the shared 16-bit patch index buffer
         glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
+        beginTerrainDrawTiming(terrainDrawTimer);
+        const GLenum chunkPrimitive = (terrainIndexFormat == TerrainIndexFormat::TriangleStrip && terrainRenderMode != TerrainRenderMode::Clipmap)
+                                          ? GL_TRIANGLE_STRIP
+                                          : GL_TRIANGLES;
+        const GLsizei chunkIndexCount = (GLsizei)indices.size();
+        const GLsizei quadrantIndexCount = chunkIndexCount / 4;
+        const int nodeFirstLoc = glGetUniformLocation(shaderProgram, "nodeFirst");
+        const int nodeStrideLoc = glGetUniformLocation(shaderProgram, "nodeStride");
+        const int morphRangeLoc = glGetUniformLocation(shaderProgram, "morphRange");
+
+        // Every mode but Clipmap adds one box per candidate draw, in order, and draws only the
+        // candidates whose box survives the frustum test
+        frustumCuller.setFrustum(mvp);
+        frustumCuller.clear();
+        visibleDraws.clear();
+
+        if (terrainRenderMode == TerrainRenderMode::Streaming)
+        {
+            for (const TerrainTileCache::Draw &draw : streamingDraws)
+            {
+                glm::vec3 boxMin, boxMax;
+                terrainTileCache.drawBounds(draw, baseAmplitude, boxMin, boxMax);
+                frustumCuller.add(boxMin, boxMax);
+            }
+            frustumCuller.cull(visibleDraws);
+
+            // A tile whose children are only partly ready draws the quadrants they would cover
+            const int tileLayerLoc = glGetUniformLocation(shaderProgram, "tileLayer");
+            const int tileFirstLoc = glGetUniformLocation(shaderProgram, "tileFirst");
+            const int tileSpacingLoc = glGetUniformLocation(shaderProgram, "tileSpacing");
+            const int skirtDepthLoc = glGetUniformLocation(shaderProgram, "skirtDepth");
+            for (int index : visibleDraws)
+            {
+                const TerrainTileCache::Draw &draw = streamingDraws[index];
+                glUniform1i(tileLayerLoc, draw.slot);
+                glUniform2i(tileFirstLoc, draw.key.x * TerrainTileCache::tileQuads, draw.key.z * TerrainTileCache::tileQuads);
+                glUniform1f(tileSpacingLoc, terrainTileCache.tileSpacing(draw.key.level));
+                glUniform1f(skirtDepthLoc, terrainTileCache.skirtDepth(draw.key.level));
+                if (draw.quadrant < 0)
+                    glDrawElements(chunkPrimitive, chunkIndexCount, GL_UNSIGNED_SHORT, 0);
+                else
+                    glDrawElements(chunkPrimitive, quadrantIndexCount, GL_UNSIGNED_SHORT,
+                                   (void *)(draw.quadrant * quadrantIndexCount * sizeof(unsigned short)));
+            }
+        }
+        else if (terrainRenderMode == TerrainRenderMode::Clipmap)
+        {
+            // The finest level draws the full grid; every other level a ring around the level inside it.
+            // The rings always surround the camera's target, so they are not culled.
+            const int levelOriginLoc = glGetUniformLocation(shaderProgram, "levelOrigin");
+            const int levelTexelLoc = glGetUniformLocation(shaderProgram, "levelTexel");
+            const int levelLoc = glGetUniformLocation(shaderProgram, "level");
+            const int levelSpacingLoc = glGetUniformLocation(shaderProgram, "levelSpacing");
+            const int morphStartLoc = glGetUniformLocation(shaderProgram, "morphStart");
+            for (int level = 0; level < terrainClipmap.levelCount(); ++level)
+            {
+                const int part = (level == 0) ? 0 : 1 + terrainClipmap.ringVariant(level);
+                const bool coarsest = (level + 1 == terrainClipmap.levelCount());
+                glm::ivec2 origin = terrainClipmap.levelOrigin(level);
+                glm::ivec2 texel = terrainClipmap.levelTexel(level);
+                glUniform2i(levelOriginLoc, origin.x, origin.y);
+                glUniform2i(levelTexelLoc, texel.x, texel.y);
+                glUniform1i(levelLoc, level);
+                glUniform1f(levelSpacingLoc, terrainClipmap.levelSpacing(level));
+                glUniform1f(morphStartLoc, coarsest ? 1e30f : (float)(GeometryClipmap::ringQuads / 2 - GeometryClipmap::transitionWidth));
+                glDrawElements(GL_TRIANGLES, (GLsizei)GeometryClipmap::indexCount(part), GL_UNSIGNED_SHORT,
+                               (void *)(GeometryClipmap::indexOffset(part) * sizeof(unsigned short)));
+            }
+        }
+        else if (terrainRenderMode == TerrainRenderMode::Cdlod)
+        {
+            // Each selected node is the patch at a vertex stride of 2^level; a partially selected
+            // node draws only the quadrants its finer children do not cover
+            cdlodQuadtree.select(camera.GetCameraPosition(), baseAmplitude, cdlodSelection);
+            for (const CdlodQuadtree::Selection &node : cdlodSelection)
+            {
+                glm::vec3 boxMin, boxMax;
+                cdlodQuadtree.selectionBounds(node, baseAmplitude, boxMin, boxMax);
+                frustumCuller.add(boxMin, boxMax);
+            }
+            frustumCuller.cull(visibleDraws);
+
+            if (horizonCulling)
+            {
+                // Only level 0 nodes draw a chunk's own vertices; coarser ones interpolate across chunks
+                horizonDraws.clear();
+                for (int index : visibleDraws)
+                {
+                    const CdlodQuadtree::Selection &node = cdlodSelection[index];
+                    HorizonDraw draw;
+                    cdlodQuadtree.selectionBounds(node, baseAmplitude, draw.boxMin, draw.boxMax);
+                    int size = 1 << node.level;
+                    glm::ivec2 first(node.firstX / TerrainChunks::chunkQuads, node.firstZ / TerrainChunks::chunkQuads);
+                    if (node.quadrant >= 0)
+                    {
+                        size /= 2;
+                        first += glm::ivec2((node.quadrant & 1) * size, (node.quadrant >> 1) * size);
+                    }
+                    draw.chunks = glm::ivec4(first.x, first.y, first.x + size - 1, first.y + size - 1);
+                    draw.fullResolution = node.level == 0;
+                    horizonDraws.push_back(draw);
+                }
+                cullHiddenDraws(horizonCuller, mvp, camera.GetCameraPosition(), terrainGpuGrid, baseAmplitude, horizonDraws, visibleDraws);
+            }
+
+            for (int index : visibleDraws)
+            {
+                const CdlodQuadtree::Selection &node = cdlodSelection[index];
+                glm::vec2 morphRange = cdlodQuadtree.morphRange(node.level);
+                glUniform2i(nodeFirstLoc, node.firstX, node.firstZ);
+                glUniform1i(nodeStrideLoc, 1 << node.level);
+                glUniform2f(morphRangeLoc, morphRange.x, morphRange.y);
+                if (node.quadrant < 0)
+                    glDrawElements(chunkPrimitive, chunkIndexCount, GL_UNSIGNED_SHORT, 0);
+                else
+                    glDrawElements(chunkPrimitive, quadrantIndexCount, GL_UNSIGNED_SHORT,
+                                   (void *)(node.quadrant * quadrantIndexCount * sizeof(unsigned short)));
+            }
+        }
+        else if (terrainRenderMode == TerrainRenderMode::HeightTexture)
+        {
+            addChunkBounds(frustumCuller, terrainGpuGrid, baseAmplitude);
+            frustumCuller.cull(visibleDraws);
+            if (horizonCulling)
+                cullHiddenChunks(mvp, camera.GetCameraPosition(), baseAmplitude, visibleDraws);
+
+            // Every visible chunk at full resolution, never morphing
+            glUniform1i(nodeStrideLoc, 1);
+            glUniform2f(morphRangeLoc, 1e30f, 2e30f);
+            for (int i : visibleDraws)
+            {
+                const TerrainChunks::Extent &extent = terrainGpuGrid.chunks[i];
+                glUniform2i(nodeFirstLoc, extent.firstX, extent.firstZ);
+                glDrawElements(chunkPrimitive, chunkIndexCount, GL_UNSIGNED_SHORT, 0);
+            }
+        }
+        else
+        {
+            addChunkBounds(frustumCuller, terrainGpuGrid, baseAmplitude);
+            frustumCuller.cull(visibleDraws);
+            if (horizonCulling)
+                cullHiddenChunks(mvp, camera.GetCameraPosition(), baseAmplitude, visibleDraws);
+
+            const glm::vec2 &heightRange = terrainGpuGrid.compactHeightRange;
+            glUniform2f(glGetUniformLocation(shaderProgram, "heightRange"), heightRange.x, heightRange.y);
+            for (int i : visibleDraws)
+            {
+                // Compact vertices are placed relative to their chunk
+                const TerrainChunks::Extent &extent = terrainGpuGrid.chunks[i];
+                glUniform2i(nodeFirstLoc, extent.firstX, extent.firstZ);
+
+                // Each chunk owns a full chunkVertices x chunkVertices slot of the vertex buffer
+                GLint baseVertex = (GLint)(i * TerrainChunks::chunkVertices * TerrainChunks::chunkVertices);
+                if (terrainGpuGrid.chunkIndexRanges.empty() || terrainGpuGrid.chunkIndexRanges[i].y == 0)
+                {
+                    glDrawElementsBaseVertex(chunkPrimitive, chunkIndexCount, GL_UNSIGNED_SHORT, 0, baseVertex);
+                }
+                else
+                {
+                    const glm::ivec3 &range = terrainGpuGrid.chunkIndexRanges[i];
+                    glDrawElementsBaseVertex(GL_TRIANGLES, range.y, GL_UNSIGNED_SHORT, (void *)((indices.size() + range.x) * sizeof(unsigned short)), baseVertex);
+                }
+            }
+        }
+        endTerrainDrawTiming(terrainDrawTimer);
 
         // // Render Water Plane
         // glUseProgram(waterShaderProgram);
@@ -857,6 +1645,9 @@ int main()
         checkOpenGLError();
     }
 
+    // Stop the LLM worker before tearing down the context
+    stopLlmWorker();
+
     // Cleanup ImGui resources
     cleanupImGui();
 
@@ -864,6 +1655,16 @@ int main()
     glDeleteVertexArrays(1, &VAO);
     glDeleteBuffers(1, &VBO);
     glDeleteBuffers(1, &EBO);
+    glDeleteTextures(1, &heightTexture);
+    glDeleteTextures(1, &terrainUpload.heightTexture);
+    glDeleteBuffers(1, &terrainUpload.vertexBuffer);
+    for (SpareTerrainStorage &spare : terrainUpload.spares)
+    {
+        glDeleteTextures(1, &spare.heightTexture);
+        glDeleteBuffers(1, &spare.vertexBuffer);
+    }
+    glDeleteTextures(1, &clipmapTexture);
+    glDeleteTextures(1, &tileTexture);
     glDeleteProgram(shaderProgram);
 
     // Delete water resources
@@ -889,6 +1690,25 @@ void processInput(GLFWwindow *window)
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
 
+    // Switch the shared patch between triangle strips and lists (I), once per key press
+    bool indexFormatKey = glfwGetKey(window, GLFW_KEY_I) == GLFW_PRESS;
+    if (indexFormatKey && !indexFormatKeyPressed && terrainRenderMode != TerrainRenderMode::Clipmap)
+    {
+        terrainIndexFormat = (terrainIndexFormat == TerrainIndexFormat::TriangleStrip) ? TerrainIndexFormat::TriangleList : TerrainIndexFormat::TriangleStrip;
+        buildTerrainIndices(indices, terrainRenderMode == TerrainRenderMode::Streaming, terrainIndexFormat);
+        uploadTerrainIndices(VAO, EBO, indices);
+        glBindVertexArray(0);
+
+        // Start a fresh average for the new format
+        resetTerrainDrawTiming(terrainDrawTimer);
+        std::cout << "Terrain index format: " << (terrainIndexFormat == TerrainIndexFormat::TriangleStrip ? "strips" : "lists") << ", "
+                  << indices.size() << " indices (" << indices.size() * sizeof(unsigned short) << " bytes), ACMR "
+                  << VertexCacheOptimizer::averageCacheMissRatio(indices.data(), indices.size(),
+                                                                 terrainIndexFormat == TerrainIndexFormat::TriangleStrip, terrainRestartIndex)
+                  << std::endl;
+    }
+    indexFormatKeyPressed = indexFormatKey;
+
     // Get camera direction vectors
     glm::vec3 cameraFront = camera.GetCameraFront();                                        // Forward direction of the camera
     glm::vec3 right = glm::normalize(glm::cross(cameraFront, glm::vec3(0.0f, 1.0f, 0.0f))); // Right direction relative to camera
@@ -985,104 +1805,459 @@ void scroll_callback(GLFWwindow *window, double xOffset, double yOffset)
     camera.ProcessMouseScroll(yOffset);
 }
 
+// Build the 16-bit index buffer shared by every chunk: a full chunkQuads x chunkQuads patch whose
+// vertex (x, z) has index x + z * chunkVertices. Smaller chunks on the far edges reuse it with
+// their vertices past the edge collapsed onto it, which makes the extra triangles degenerate.
+// The quads are emitted one quadrant at a time (top-left, top-right, bottom-left, bottom-right), so
+// CDLOD can draw any single quadrant as a contiguous quarter of the buffer. With `skirts`, every
+// quadrant is followed by a skirt hanging from its four edges, whose lower vertices have the index
+// of the edge vertex plus chunkVertices^2; they hide cracks where tiles of different levels meet.
+//
+// TriangleList emits 6 indices per quad. TriangleStrip emits each row of quads (and each skirt
+// edge) as one strip ended by terrainRestartIndex: 2 indices per quad plus 3 per row, for the same
+// triangles with the same winding, since a strip flips the order of its odd triangles.
+//
+// With vertexCacheOptimization, each quadrant's list is reordered by VertexCacheOptimizer, and
+// strips run along bands of columns narrow enough that a row's bottom vertices are still cached
+// when the next row uses them as its top (at the cost of one restart per row per band).
+void buildTerrainIndices(std::vector<unsigned short> &indices, bool skirts, TerrainIndexFormat format)
+{
+    const int quads = TerrainChunks::chunkQuads;
+    const int half = quads / 2;
+    const int pitch = TerrainChunks::chunkVertices;
+    const unsigned short skirtOffset = (unsigned short)(pitch * pitch);
+    const bool strips = (format == TerrainIndexFormat::TriangleStrip);
+
+    // Each strip row leaves its band + 1 bottom vertices for the next one, which needs them after
+    // fetching its own band + 1; the first row of a band misses on both, so a FIFO cache only
+    // settles into reusing them if 2 * (band + 1) vertices fit
+    int band = half;
+    while (vertexCacheOptimization && 2 * (band + 1) > VertexCacheOptimizer::cacheSize)
+        band /= 2;
+
+    VertexCacheOptimizer optimizer;
+    indices.clear();
+    if (strips)
+        indices.reserve(4 * ((size_t)(half / band) * half * (2 * (band + 1) + 1) + (skirts ? (size_t)4 * (2 * (half + 1) + 1) : 0)));
+    else
+        indices.reserve((size_t)quads * quads * 6 + (skirts ? (size_t)16 * half * 6 : 0));
+    for (int quadrant = 0; quadrant < 4; ++quadrant)
+    {
+        const int firstX = (quadrant & 1) * half;
+        const int firstZ = (quadrant >> 1) * half;
+        const size_t quadrantStart = indices.size();
+        if (strips)
+        {
+            for (int bandX = firstX; bandX < firstX + half; bandX += band)
+            {
+                // Alternating top and bottom vertices: each quad is split along the same diagonal as the list
+                for (int z = firstZ; z < firstZ + half; ++z)
+                {
+                    for (int x = bandX; x <= bandX + band; ++x)
+                    {
+                        indices.push_back((unsigned short)(z * pitch + x));
+                        indices.push_back((unsigned short)((z + 1) * pitch + x));
+                    }
+                    indices.push_back(terrainRestartIndex);
+                }
+            }
+        }
+        else
+        {
+            for (int z = firstZ; z < firstZ + half; ++z)
+            {
+                for (int x = firstX; x < firstX + half; ++x)
+                {
+                    unsigned short topLeft = (unsigned short)(z * pitch + x);
+                    unsigned short topRight = topLeft + 1;
+                    unsigned short bottomLeft = (unsigned short)(topLeft + pitch);
+                    unsigned short bottomRight = bottomLeft + 1;
+
+                    // Triangle 1
+                    indices.push_back(topLeft);
+                    indices.push_back(bottomLeft);
+                    indices.push_back(topRight);
+
+                    // Triangle 2
+                    indices.push_back(topRight);
+                    indices.push_back(bottomLeft);
+                    indices.push_back(bottomRight);
+                }
+            }
+        }
+
+        // Top, bottom, left and right edges of the quadrant, one wall quad per edge segment
+        const int lastX = firstX + half;
+        const int lastZ = firstZ + half;
+        auto edgeVertex = [&](int edge, int i) {
+            switch (edge)
+            {
+            case 0: return (unsigned short)(firstZ * pitch + firstX + i);
+            case 1: return (unsigned short)(lastZ * pitch + firstX + i);
+            case 2: return (unsigned short)((firstZ + i) * pitch + firstX);
+            default: return (unsigned short)((firstZ + i) * pitch + lastX);
+            }
+        };
+        if (skirts && strips)
+        {
+            for (int edge = 0; edge < 4; ++edge)
+            {
+                for (int i = 0; i <= half; ++i)
+                {
+                    indices.push_back(edgeVertex(edge, i));
+                    indices.push_back((unsigned short)(edgeVertex(edge, i) + skirtOffset));
+                }
+                indices.push_back(terrainRestartIndex);
+            }
+        }
+        else if (skirts)
+        {
+            for (int i = 0; i < half; ++i)
+            {
+                for (int edge = 0; edge < 4; ++edge)
+                {
+                    const unsigned short start = edgeVertex(edge, i);
+                    const unsigned short end = edgeVertex(edge, i + 1);
+                    indices.push_back(start);
+                    indices.push_back((unsigned short)(start + skirtOffset));
+                    indices.push_back(end);
+
+                    indices.push_back(end);
+                    indices.push_back((unsigned short)(start + skirtOffset));
+                    indices.push_back((unsigned short)(end + skirtOffset));
+                }
+            }
+        }
+
+        // Quadrants stay contiguous, so each is reordered on its own
+        if (!strips && vertexCacheOptimization)
+            optimizer.optimize(indices.data() + quadrantStart, indices.size() - quadrantStart);
+    }
+}
+
 // Generate Advanced Terrain with Multiple Layers of Perlin Noise
-void generateAdvancedTerrain(int width, int height, std::vector<float> &vertices, std::vector<unsigned int> &indices, std::vector<float> &normals)
+// Regenerates the heights (aprons included) of every dirty chunk; a new resolution re-chunks the
+// grid, which dirties every chunk. Chunks are independent tasks on the thread pool and every
+// sample depends only on its grid position, so the result is identical for any thread count
+// and a sample shared by two chunks gets the same height in both.
+//
+// With a step above 1 (a power of two), chunks gets a coarse level of the width x height grid
+// instead: every step-th sample, with the far edges rounded up to a whole step. The level's
+// spacing is the grid's times a power of two, so each of its samples is exactly the grid sample
+// it stands for. `coarser`, the level with twice the step, supplies the samples on even rows and
+// columns, so refining only evaluates the other three quarters.
+void generateAdvancedTerrain(int width, int height, const TerrainParameters &params, TerrainChunks &chunks, int step,
+                             const TerrainChunks *coarser)
 {
-    float scale = 2.0f / (std::max(width, height) - 1);
+    std::lock_guard<std::mutex> generationLock(terrainGenerationMutex);
+
+    const float scale = 2.0f / (std::max(width, height) - 1) * step;
+    width = (width - 1 + step - 1) / step + 1;
+    height = (height - 1 + step - 1) / step + 1;
+
+    // Octave weights only depend on the terrain parameters, so build them once per generation.
+    // Heights are generated at unit amplitude; baseAmplitude is applied by the heightScale uniform.
+    const PerlinNoise::Octaves octaves = PerlinNoise::makeOctaves(params.numOctaves, params.persistence, params.lacunarity, params.baseFrequency, 1.0f);
+
+    chunks.resize(width, height, scale, -0.5f, -0.5f);
+
+    std::vector<size_t> dirtyChunks;
+    for (size_t i = 0; i < chunks.size(); ++i)
+    {
+        if (chunks.chunk(i).dirty)
+            dirtyChunks.push_back(i);
+    }
+    if (dirtyChunks.empty())
+        return;
 
-    // Clear previous normals
-    normals.resize(width * height * 3, 0.0f); // x, y, z normals for each vertex
+    const int apron = TerrainChunks::apron;
 
-    for (int z = 0; z < height; ++z)
+    // With cached octave layers, edits that only change persistence or amplitude skip the noise
+    // entirely. Previews evaluate it directly rather than replace the full grid's layers. Evaluating
+    // every layer costs a full grid of samples, so a grid refined from previews reuses their samples
+    // instead, and only aims the cache at its frequency ladder: the layers are evaluated once the
+    // next edit keeps that ladder, as the weight-only edits the cache speeds up do.
+    bool useLayerCache = false;
+    if (step == 1)
     {
-        for (int x = 0; x < width; ++x)
+        if (coarser == nullptr ||
+            octaveLayerCache.isLaidOut(width, height, apron, chunks.originX(), scale, params.baseFrequency, params.lacunarity))
+            useLayerCache = octaveLayerCache.prepare(width, height, apron, chunks.originX(), scale, params.baseFrequency,
+                                                     params.lacunarity, params.numOctaves);
+        else
+            octaveLayerCache.layOut(width, height, apron, chunks.originX(), scale, params.baseFrequency, params.lacunarity);
+    }
+    const bool reuseCoarser = !useLayerCache && coarser != nullptr && coarser->spacing() == 2.0f * scale &&
+                              coarser->originX() == chunks.originX() && coarser->originZ() == chunks.originZ() &&
+                              coarser->width() == width / 2 + 1 && coarser->height() == height / 2 + 1;
+
+    // One chunk per task, written row by row by the SIMD batch kernel. The chunks are queued a
+    // slice at a time, so other work on the pool (the render thread's own loops, streamed tiles)
+    // waits for at most one slice however large the grid, and progress can be shown meanwhile.
+    const int sliceChunks = 4 * (int)threadPool.size();
+    terrainGenerationDone = 0;
+    terrainGenerationStep = step;
+    terrainGenerationTotal = (int)dirtyChunks.size();
+    auto generateChunks = [&](int first, int last) {
+        HeightfieldDecimator decimator;
+        VertexCacheOptimizer optimizer;
+        std::vector<float> oddSamples;
+        for (int i = first; i < last; ++i)
         {
-            float xPos = (x * scale) - 0.5f;
-            float zPos = (z * scale) - 0.5f;
+            TerrainChunks::Chunk &chunk = chunks.chunk(dirtyChunks[i]);
+            Heightfield &heights = chunk.heights;
+            const int firstX = chunk.extent.firstX - apron;
 
-            float heightValue = 0.0f;
-            float amplitude = baseAmplitude;
-            float frequency = baseFrequency;
+            for (int row = 0; row < heights.height(); ++row)
+            {
+                int z = chunk.extent.firstZ - apron + row;
+                if (useLayerCache)
+                {
+                    octaveLayerCache.combineRow(z, firstX, heights.width(), octaves.amplitudes, heights.row(row));
+                }
+                else if (reuseCoarser && z % 2 == 0)
+                {
+                    // Even columns come from the coarser level; odd ones are evaluated in one strided batch
+                    float *out = heights.row(row);
+                    const int firstOdd = firstX + (firstX % 2 == 0 ? 1 : 0);
+                    const int oddCount = (firstX + heights.width() - firstOdd + 1) / 2;
+                    oddSamples.resize(oddCount);
+                    perlin.fbmRow(chunks.originX(), scale, chunks.worldZ(z), octaves, oddSamples.data(), oddCount, firstOdd, 2);
+                    for (int x = firstX; x < firstX + heights.width(); ++x)
+                        out[x - firstX] = x % 2 == 0 ? coarser->heightAt(x / 2, z / 2) : oddSamples[(x - firstOdd) / 2];
+                }
+                else
+                {
+                    perlin.fbmRow(chunks.originX(), scale, chunks.worldZ(z), octaves, heights.row(row), heights.width(), firstX);
+                }
+            }
 
-            for (int octave = 0; octave < numOctaves; ++octave)
+            // Height range of the chunk itself (for the CDLOD bounding boxes)
+            chunk.minHeight = FLT_MAX;
+            chunk.maxHeight = -FLT_MAX;
+            for (int row = apron; row < heights.height() - apron; ++row)
             {
-                heightValue += amplitude * perlin.noise(xPos * frequency, zPos * frequency, numOctaves, persistence);
-                amplitude *= persistence;
-                frequency *= lacunarity;
+                const float *first = heights.row(row) + apron;
+                auto range = std::minmax_element(first, first + chunk.extent.quadsX + 1);
+                chunk.minHeight = std::min(chunk.minHeight, *range.first);
+                chunk.maxHeight = std::max(chunk.maxHeight, *range.second);
             }
 
-            vertices.push_back(xPos);
-            vertices.push_back(heightValue); // Height
-            vertices.push_back(zPos);
+            // Previews are replaced within moments, so only the full grid is decimated
+            if (step == 1)
+                decimateTerrainChunk(decimator, optimizer, chunk);
+            else
+                chunk.decimatedIndices.clear();
+            chunk.dirty = false;
+            chunk.uploadPending = true;
+        }
+    };
+    for (int first = 0; first < (int)dirtyChunks.size(); first += sliceChunks)
+    {
+        const int last = std::min(first + sliceChunks, (int)dirtyChunks.size());
+        threadPool.parallelFor(first, last, 1, generateChunks);
+        terrainGenerationDone = last;
+    }
+    terrainGenerationTotal = 0;
+}
+
+// Replace the chunk's decimated index list (cleared unless decimationMaxError is in use). Only the
+// VertexBuffer mode draws explicit triangles, so only it is decimated. Borders stay at full
+// resolution, so independently decimated chunks still meet.
+void decimateTerrainChunk(HeightfieldDecimator &decimator, VertexCacheOptimizer &optimizer, TerrainChunks::Chunk &chunk)
+{
+    chunk.decimatedIndices.clear();
+    if (terrainRenderMode != TerrainRenderMode::VertexBuffer || decimationMaxError <= 0.0f)
+        return;
+
+    decimator.decimate(chunk.heights, TerrainChunks::apron, TerrainChunks::apron, chunk.extent.quadsX, chunk.extent.quadsZ, decimationMaxError,
+                       TerrainChunks::chunkVertices, chunk.decimatedIndices);
+    if (vertexCacheOptimization)
+        optimizer.optimize(chunk.decimatedIndices.data(), chunk.decimatedIndices.size());
+}
+
+// Decimate every chunk again at the current decimationMaxError and mark its index list for upload
+void decimateTerrainChunks(TerrainChunks &chunks)
+{
+    threadPool.parallelFor(0, (int)chunks.size(), 1, [&](int first, int last) {
+        HeightfieldDecimator decimator;
+        VertexCacheOptimizer optimizer;
+        for (int i = first; i < last; ++i)
+        {
+            decimateTerrainChunk(decimator, optimizer, chunks.chunk(i));
+            chunks.chunk(i).indicesPending = true;
+        }
+    });
+}
+
+// Whether generateAdvancedTerrain would only combine cached octave layers for this grid
+bool terrainLayersCached(int width, int height, const TerrainParameters &params)
+{
+    std::lock_guard<std::mutex> generationLock(terrainGenerationMutex);
+
+    const float scale = 2.0f / (std::max(width, height) - 1);
+    return octaveLayerCache.isPrepared(width, height, TerrainChunks::apron, -0.5f, scale, params.baseFrequency, params.lacunarity,
+                                       params.numOctaves);
+}
+
+// Write the interleaved vertex layout (see terrainVertexFloats) of one chunk as a full
+// chunkVertices x chunkVertices patch; vertices past a smaller chunk's far edges are clamped
+// onto that edge. `vertices` may be mapped GPU memory: it is written front to back and never read.
+void writeChunkVertices(const TerrainChunks &chunks, const TerrainChunks::Chunk &chunk, const PerlinNoise::Octaves &octaves, float *vertices)
+{
+    const TerrainChunks::Extent &extent = chunk.extent;
+    const int apron = TerrainChunks::apron;
+
+    float *out = vertices;
+    for (int localZ = 0; localZ < TerrainChunks::chunkVertices; ++localZ)
+    {
+        const int z = std::min(localZ, extent.quadsZ);
+        const int gridZ = extent.firstZ + z;
+
+        for (int localX = 0; localX < TerrainChunks::chunkVertices; ++localX, out += terrainVertexFloats)
+        {
+            const int x = std::min(localX, extent.quadsX);
+            const int gridX = extent.firstX + x;
+
+            out[0] = chunks.worldX(gridX);
+            out[1] = chunk.heights.at(x + apron, z + apron); // Height
+            out[2] = chunks.worldZ(gridZ);
 
             // Texture coordinates
-            vertices.push_back(static_cast<float>(x) / (width - 1));
-            vertices.push_back(static_cast<float>(z) / (height - 1));
+            out[3] = static_cast<float>(gridX) / (chunks.width() - 1);
+            out[4] = static_cast<float>(gridZ) / (chunks.height() - 1);
 
-            // If not at the last row/column, generate indices for this quad
-            if (x < width - 1 && z < height - 1)
-            {
-                int topLeft = z * width + x;
-                int topRight = topLeft + 1;
-                int bottomLeft = (z + 1) * width + x;
-                int bottomRight = bottomLeft + 1;
-
-                // Triangle 1
-                indices.push_back(topLeft);
-                indices.push_back(bottomLeft);
-                indices.push_back(topRight);
-
-                // Triangle 2
-                indices.push_back(topRight);
-                indices.push_back(bottomLeft);
-                indices.push_back(bottomRight);
-            }
+            glm::vec3 normal = chunkVertexNormal(chunks, chunk, octaves, x, z);
+            out[5] = normal.x;
+            out[6] = normal.y;
+            out[7] = normal.z;
         }
     }
+}
 
-    // Calculate normals by averaging adjacent triangle normals
-    for (size_t i = 0; i < indices.size(); i += 3)
+// Write one chunk as CompactTerrainVertex, in the same patch order as writeChunkVertices.
+// Heights are quantized over heightRange, which the draw passes back: one range for the whole
+// grid, so the edge vertices neighbouring chunks share decode to the same height.
+void writeCompactChunkVertices(const TerrainChunks &chunks, const TerrainChunks::Chunk &chunk, const PerlinNoise::Octaves &octaves,
+                               const glm::vec2 &heightRange, CompactTerrainVertex *vertices)
+{
+    const TerrainChunks::Extent &extent = chunk.extent;
+    const int apron = TerrainChunks::apron;
+    const float range = heightRange.y - heightRange.x;
+    const float toUnit = range > 0.0f ? 65535.0f / range : 0.0f;
+
+    CompactTerrainVertex *out = vertices;
+    for (int localZ = 0; localZ < TerrainChunks::chunkVertices; ++localZ)
     {
-        // Get vertex indices for this triangle
-        unsigned int idx0 = indices[i];
-        unsigned int idx1 = indices[i + 1];
-        unsigned int idx2 = indices[i + 2];
+        const int z = std::min(localZ, extent.quadsZ);
+        for (int localX = 0; localX < TerrainChunks::chunkVertices; ++localX, ++out)
+        {
+            const int x = std::min(localX, extent.quadsX);
+            float quantized = (chunk.heights.at(x + apron, z + apron) - heightRange.x) * toUnit + 0.5f;
+            out->height = (unsigned short)std::min(std::max(quantized, 0.0f), 65535.0f);
+            encodeOctahedralNormal(chunkVertexNormal(chunks, chunk, octaves, x, z), out->normal);
+        }
+    }
+}
 
-        // Get vertex positions
-        glm::vec3 v0(vertices[5 * idx0], vertices[5 * idx0 + 1], vertices[5 * idx0 + 2]);
-        glm::vec3 v1(vertices[5 * idx1], vertices[5 * idx1 + 1], vertices[5 * idx1 + 2]);
-        glm::vec3 v2(vertices[5 * idx2], vertices[5 * idx2 + 1], vertices[5 * idx2 + 2]);
+// Normal of chunk vertex (x, z) in the current NormalMode. The apron provides the neighbours of
+// edge vertices, so normals match across chunks.
+glm::vec3 chunkVertexNormal(const TerrainChunks &chunks, const TerrainChunks::Chunk &chunk, const PerlinNoise::Octaves &octaves, int x, int z)
+{
+    const int apron = TerrainChunks::apron;
+    if (terrainNormalMode == NormalMode::TriangleAverage)
+        return triangleAverageNormal(chunk.heights, x + apron, z + apron);
+    if (terrainNormalMode == NormalMode::Analytic)
+        return analyticNormal(octaves, chunks.worldX(chunk.extent.firstX + x), chunks.worldZ(chunk.extent.firstZ + z));
+    return centralDifferenceNormal(chunk.heights, x + apron, z + apron);
+}
 
-        // Calculate two edges
-        glm::vec3 edge1 = v1 - v0;
-        glm::vec3 edge2 = v2 - v0;
+// Octahedral encoding: project the unit normal onto the octahedron |x| + |y| + |z| = 1 and unfold
+// it onto a square, with the upper (y > 0) hemisphere inside the inner diamond where terrain
+// normals are, then store each coordinate as snorm8 (decoded by octDecode in the vertex shader)
+void encodeOctahedralNormal(const glm::vec3 &normal, signed char encoded[2])
+{
+    float sum = std::fabs(normal.x) + std::fabs(normal.y) + std::fabs(normal.z);
+    float u = normal.x / sum;
+    float v = normal.z / sum;
+    if (normal.y < 0.0f)
+    {
+        float foldedU = (1.0f - std::fabs(v)) * (u >= 0.0f ? 1.0f : -1.0f);
+        float foldedV = (1.0f - std::fabs(u)) * (v >= 0.0f ? 1.0f : -1.0f);
+        u = foldedU;
+        v = foldedV;
+    }
+    encoded[0] = (signed char)std::lround(std::min(std::max(u, -1.0f), 1.0f) * 127.0f);
+    encoded[1] = (signed char)std::lround(std::min(std::max(v, -1.0f), 1.0f) * 127.0f);
+}
 
-        // Calculate normal using cross product
-        glm::vec3 normal = glm::normalize(glm::cross(edge1, edge2));
+// Normal at sample (x, z) from the four neighbouring heights: n = normalize(-dh/dx, 1, -dh/dz).
+// Falls back to one-sided differences on the heightfield's edges.
+glm::vec3 centralDifferenceNormal(const Heightfield &heights, int x, int z)
+{
+    const int left = std::max(x - 1, 0);
+    const int right = std::min(x + 1, heights.width() - 1);
+    const int up = std::max(z - 1, 0);
+    const int down = std::min(z + 1, heights.height() - 1);
+
+    float dhdx = (heights.at(right, z) - heights.at(left, z)) / ((right - left) * heights.spacing());
+    float dhdz = (heights.at(x, down) - heights.at(x, up)) / ((down - up) * heights.spacing());
+    float invLength = 1.0f / std::sqrt(dhdx * dhdx + 1.0f + dhdz * dhdz);
+    return glm::vec3(-dhdx * invLength, invLength, -dhdz * invLength);
+}
+
+// Normal at sample (x, z) by averaging the adjacent triangle normals (the original normal path)
+glm::vec3 triangleAverageNormal(const Heightfield &heights, int x, int z)
+{
+    const int width = heights.width();
+    const int height = heights.height();
+
+    // Positions relative to (x, z) are exact, so chunks sharing a vertex get the same normal
+    const float spacing = heights.spacing();
+    auto position = [&](int px, int pz) {
+        return glm::vec3((px - x) * spacing, heights.at(px, pz), (pz - z) * spacing);
+    };
+    auto triangleNormal = [](const glm::vec3 &v0, const glm::vec3 &v1, const glm::vec3 &v2) {
+        return glm::normalize(glm::cross(v1 - v0, v2 - v0));
+    };
 
-        // Add normal to each vertex of the triangle
-        normals[3 * idx0] += normal.x;
-        normals[3 * idx0 + 1] += normal.y;
-        normals[3 * idx0 + 2] += normal.z;
+    glm::vec3 self = position(x, z);
+    glm::vec3 normal(0.0f);
 
-        normals[3 * idx1] += normal.x;
-        normals[3 * idx1 + 1] += normal.y;
-        normals[3 * idx1 + 2] += normal.z;
+    // Quad to the bottom-right: this vertex is its top-left corner (triangle 1)
+    if (x < width - 1 && z < height - 1)
+        normal += triangleNormal(self, position(x, z + 1), position(x + 1, z));
 
-        normals[3 * idx2] += normal.x;
-        normals[3 * idx2 + 1] += normal.y;
-        normals[3 * idx2 + 2] += normal.z;
+    // Quad to the bottom-left: top-right corner (triangles 1 and 2)
+    if (x > 0 && z < height - 1)
+    {
+        glm::vec3 bottomLeft = position(x - 1, z + 1);
+        normal += triangleNormal(position(x - 1, z), bottomLeft, self);
+        normal += triangleNormal(self, bottomLeft, position(x, z + 1));
     }
 
-    // Normalize the normals for each vertex
-    for (int i = 0; i < width * height; ++i)
+    // Quad to the top-right: bottom-left corner (triangles 1 and 2)
+    if (x < width - 1 && z > 0)
     {
-        glm::vec3 normal(normals[3 * i], normals[3 * i + 1], normals[3 * i + 2]);
-        normal = glm::normalize(normal);
-        normals[3 * i] = normal.x;
-        normals[3 * i + 1] = normal.y;
-        normals[3 * i + 2] = normal.z;
+        glm::vec3 topRight = position(x + 1, z - 1);
+        normal += triangleNormal(position(x, z - 1), self, topRight);
+        normal += triangleNormal(topRight, self, position(x + 1, z));
     }
+
+    // Quad to the top-left: bottom-right corner (triangle 2)
+    if (x > 0 && z > 0)
+        normal += triangleNormal(position(x, z - 1), position(x - 1, z), self);
+
+    return glm::normalize(normal);
+}
+
+// Normal at model-space (x, z) from the exact fBm gradient
+glm::vec3 analyticNormal(const PerlinNoise::Octaves &octaves, float x, float z)
+{
+    PerlinNoise::NoiseSample sample = perlin.fbmDerivative(x, z, octaves);
+
+    float invLength = 1.0f / std::sqrt(sample.dx * sample.dx + 1.0f + sample.dy * sample.dy);
+    return glm::vec3(-sample.dx * invLength, invLength, -sample.dy * invLength);
 }
 
 void generateWaterPlane(std::vector<float> &waterVertices, float width, float depth)
@@ -1117,9 +2292,10 @@ unsigned int compileShader(const char *shaderSource, GLenum shaderType)
 }
 
 // Create Shader Program
-unsigned int createShaderProgram()
+// Both render modes share the fragment shader; they differ in where the vertex data comes from.
+unsigned int createShaderProgram(TerrainRenderMode renderMode, bool compactVertices)
 {
-    const char *vertexShaderSource = R"glsl(
+    const char *vertexBufferShaderSource = R"glsl(
         #version 330 core
         layout(location = 0) in vec3 aPos;         // Position attribute
         layout(location = 1) in vec2 aTexCoord;    // Texture coordinate attribute
@@ -1131,25 +2307,289 @@ unsigned int createShaderProgram()
 
         uniform mat4 transform;    // MVP matrix (combined model, view, projection)
         uniform mat4 model;        // Model matrix for normal transformation
+        uniform float heightScale; // Terrain amplitude; heights in the buffer are at unit amplitude
 
         void main()
         {
+            // Scale the unit-amplitude height
+            vec3 position = vec3(aPos.x, aPos.y * heightScale, aPos.z);
+
             // Transform the vertex position
-            FragPos = vec3(model * vec4(aPos, 1.0));
-            
+            FragPos = vec3(model * vec4(position, 1.0));
+
+            // The unit normal is proportional to (-dh/dx, 1, -dh/dz); scaling h by heightScale
+            // scales the slope terms (exact for the gradient-based normal modes)
+            vec3 scaledNormal = normalize(vec3(aNormal.x * heightScale, aNormal.y, aNormal.z * heightScale));
+
             // Correct the normals based on model transformation (transpose inverse)
-            Normal = mat3(transpose(inverse(model))) * aNormal;
+            Normal = mat3(transpose(inverse(model))) * scaledNormal;
 
             // Pass through texture coordinates
             TexCoords = aTexCoord;
 
             // Apply the transform matrix (MVP) to compute final position
-            gl_Position = transform * vec4(aPos, 1.0);
+            gl_Position = transform * vec4(position, 1.0);
+        }
+
+
+    )glsl";
+
+    const char *compactVertexShaderSource = R"glsl(
+        #version 330 core
+        layout(location = 0) in uint aHeight;      // Height quantized over heightRange (CompactTerrainVertex)
+        layout(location = 2) in ivec2 aNormal;     // Octahedral-encoded normal, snorm8
+
+        out vec2 TexCoords;        // Pass texture coordinates to fragment shader
+        out vec3 FragPos;          // Pass fragment position to fragment shader
+        out vec3 Normal;           // Pass normal to fragment shader
+
+        uniform mat4 transform;    // MVP matrix (combined model, view, projection)
+        uniform mat4 model;        // Model matrix for normal transformation
+        uniform float heightScale; // Terrain amplitude; heights in the buffer are at unit amplitude
+
+        uniform ivec2 gridSize;    // Vertices along x and z
+        uniform vec2 gridOrigin;   // Model-space x/z of vertex (0, 0)
+        uniform float gridSpacing; // Distance between neighbouring vertices
+        uniform int chunkPitch;    // Vertices per row of a chunk's patch
+        uniform ivec2 nodeFirst;   // Grid coordinates of the current chunk's first vertex
+        uniform vec2 heightRange;  // Unit-amplitude (min, max) height the grid's compact vertices are quantized over
+
+        // Inverse of encodeOctahedralNormal
+        vec3 octDecode(vec2 encoded)
+        {
+            vec3 n = vec3(encoded.x, 1.0 - abs(encoded.x) - abs(encoded.y), encoded.y);
+            float fold = max(-n.y, 0.0);
+            n.x += n.x >= 0.0 ? -fold : fold;
+            n.z += n.z >= 0.0 ? -fold : fold;
+            return normalize(n);
+        }
+
+        void main()
+        {
+            // gl_VertexID includes the chunk's base vertex; its place in the patch gives x/z.
+            // Vertices past the grid collapse onto its far edges, as they were written.
+            int patchVertex = gl_VertexID % (chunkPitch * chunkPitch);
+            ivec2 local = ivec2(patchVertex % chunkPitch, patchVertex / chunkPitch);
+            vec2 vertex = vec2(min(nodeFirst + local, gridSize - 1));
+
+            float height = mix(heightRange.x, heightRange.y, float(aHeight) / 65535.0);
+            vec2 xz = gridOrigin + vertex * gridSpacing;
+            vec3 position = vec3(xz.x, height * heightScale, xz.y);
+
+            // Transform the vertex position
+            FragPos = vec3(model * vec4(position, 1.0));
+
+            // Scale the slope terms like the float layout does
+            vec3 unitNormal = octDecode(clamp(vec2(aNormal) / 127.0, -1.0, 1.0));
+            vec3 scaledNormal = normalize(vec3(unitNormal.x * heightScale, unitNormal.y, unitNormal.z * heightScale));
+
+            // Correct the normals based on model transformation (transpose inverse)
+            Normal = mat3(transpose(inverse(model))) * scaledNormal;
+
+            TexCoords = vertex / vec2(gridSize - 1);
+
+            // Apply the transform matrix (MVP) to compute final position
+            gl_Position = transform * vec4(position, 1.0);
+        }
+    )glsl";
+
+    const char *heightTextureShaderSource = R"glsl(
+        #version 330 core
+        out vec2 TexCoords;        // Pass texture coordinates to fragment shader
+        out vec3 FragPos;          // Pass fragment position to fragment shader
+        out vec3 Normal;           // Pass normal to fragment shader
+
+        uniform mat4 transform;    // MVP matrix (combined model, view, projection)
+        uniform mat4 model;        // Model matrix for normal transformation
+        uniform float heightScale; // Terrain amplitude; heights in the texture are at unit amplitude
+
+        uniform sampler2D heightMap; // One R32F texel per grid vertex, plus a one-texel apron border
+        uniform ivec2 gridSize;      // Vertices along x and z
+        uniform vec2 gridOrigin;     // Model-space x/z of vertex (0, 0)
+        uniform float gridSpacing;   // Distance between neighbouring vertices
+        uniform vec3 viewPos;        // Camera position, for the morph distance
+
+        uniform ivec2 nodeFirst;     // Grid coordinates of the current node's (or chunk's) first vertex
+        uniform int nodeStride;      // Grid vertices between neighbouring patch vertices (2^level)
+        uniform vec2 morphRange;     // Camera distances over which odd patch vertices slide onto the coarser grid
+        uniform int chunkPitch;      // Vertices per row of the shared chunk index buffer
+
+        // Bilinear height at a (possibly fractional) grid position
+        float heightAt(vec2 gridPos)
+        {
+            vec2 texelCenter = gridPos + 1.5; // Skip the apron border
+            return textureLod(heightMap, texelCenter / vec2(gridSize + 2), 0.0).r;
+        }
+
+        void main()
+        {
+            // The shared index buffer holds x + z * chunkPitch within the patch, which arrives here as gl_VertexID.
+            // Vertices past the grid collapse onto its far edges.
+            ivec2 local = ivec2(gl_VertexID % chunkPitch, gl_VertexID / chunkPitch);
+            vec2 gridMax = vec2(gridSize - 1);
+            vec2 vertex = min(vec2(nodeFirst + local * nodeStride), gridMax);
+
+            // Morph towards the next coarser level with the distance to the unmorphed vertex, reaching
+            // it at the end of the node's range so neighbouring levels meet without cracks
+            vec2 xz = gridOrigin + vertex * gridSpacing;
+            float distanceToCamera = distance(vec3(xz.x, heightAt(vertex) * heightScale, xz.y), viewPos);
+            float morph = clamp((distanceToCamera - morphRange.x) / (morphRange.y - morphRange.x), 0.0, 1.0);
+            vec2 morphedLocal = vec2(local) - vec2(local & 1) * morph;
+            vertex = min(vec2(nodeFirst) + morphedLocal * float(nodeStride), gridMax);
+
+            xz = gridOrigin + vertex * gridSpacing;
+            vec3 position = vec3(xz.x, heightAt(vertex) * heightScale, xz.y);
+
+            // Transform the vertex position
+            FragPos = vec3(model * vec4(position, 1.0));
+
+            // Central differences like the CPU path; the apron border supplies neighbours past the grid edges
+            float dhdx = (heightAt(vertex + vec2(1.0, 0.0)) - heightAt(vertex - vec2(1.0, 0.0))) / (2.0 * gridSpacing);
+            float dhdz = (heightAt(vertex + vec2(0.0, 1.0)) - heightAt(vertex - vec2(0.0, 1.0))) / (2.0 * gridSpacing);
+            vec3 scaledNormal = normalize(vec3(-dhdx * heightScale, 1.0, -dhdz * heightScale));
+
+            // Correct the normals based on model transformation (transpose inverse)
+            Normal = mat3(transpose(inverse(model))) * scaledNormal;
+
+            TexCoords = vertex / gridMax;
+
+            // Apply the transform matrix (MVP) to compute final position
+            gl_Position = transform * vec4(position, 1.0);
+        }
+    )glsl";
+
+    const char *clipmapShaderSource = R"glsl(
+        #version 330 core
+        out vec2 TexCoords;        // Pass texture coordinates to fragment shader
+        out vec3 FragPos;          // Pass fragment position to fragment shader
+        out vec3 Normal;           // Pass normal to fragment shader
+
+        uniform mat4 transform;    // MVP matrix (combined model, view, projection)
+        uniform mat4 model;        // Model matrix for normal transformation
+        uniform float heightScale; // Terrain amplitude; heights in the texture are at unit amplitude
+
+        uniform sampler2DArray clipmapHeights; // One R32F layer per level, addressed toroidally
+        uniform int clipmapSize;     // Texels along each layer
+        uniform int ringVertices;    // Vertices per row of the shared ring index buffer
+        uniform int level;           // Layer of the current level
+        uniform ivec2 levelOrigin;   // Global sample index of the level's vertex (0, 0)
+        uniform ivec2 levelTexel;    // Texel holding that sample
+        uniform float levelSpacing;  // Distance between the level's samples
+        uniform float morphStart;    // Vertices from the level's centre where it starts morphing into the next level
+        uniform float morphWidth;    // Vertices over which the morph completes (at the level's edge)
+        uniform vec2 texCoordOrigin; // Model-space x/z where the terrain textures start
+        uniform float texCoordScale; // Terrain texture coordinates per model-space unit
+
+        float texelHeight(ivec2 vertex)
+        {
+            ivec2 texel = (levelTexel + vertex + clipmapSize) % clipmapSize; // vertex >= -1 (the apron)
+            return texelFetch(clipmapHeights, ivec3(texel, level), 0).r;
+        }
+
+        // Bilinear height at a (possibly fractional) position in the level's vertex grid; exact at vertices
+        float heightAt(vec2 vertex)
+        {
+            ivec2 cell = ivec2(floor(vertex));
+            vec2 f = vertex - vec2(cell);
+            float top = mix(texelHeight(cell), texelHeight(cell + ivec2(1, 0)), f.x);
+            float bottom = mix(texelHeight(cell + ivec2(0, 1)), texelHeight(cell + ivec2(1, 1)), f.x);
+            return mix(top, bottom, f.y);
+        }
+
+        void main()
+        {
+            // The shared index buffer holds x + z * ringVertices, which arrives here as gl_VertexID
+            ivec2 local = ivec2(gl_VertexID % ringVertices, gl_VertexID / ringVertices);
+
+            // Near the level's edge odd vertices slide onto the next coarser level's grid, reaching it
+            // exactly on the edge, so the rings meet without cracks
+            vec2 fromCentre = abs(vec2(local) - 0.5 * float(ringVertices - 1));
+            float morph = clamp((max(fromCentre.x, fromCentre.y) - morphStart) / morphWidth, 0.0, 1.0);
+            vec2 vertex = vec2(local) - vec2(local & 1) * morph;
+
+            // Global sample index times spacing: coincident vertices of two levels get identical positions
+            vec2 xz = (vec2(levelOrigin) + vertex) * levelSpacing;
+            vec3 position = vec3(xz.x, heightAt(vertex) * heightScale, xz.y);
+
+            // Transform the vertex position
+            FragPos = vec3(model * vec4(position, 1.0));
+
+            // Central differences at the level's spacing; the apron supplies neighbours past the ring edges
+            float dhdx = (heightAt(vertex + vec2(1.0, 0.0)) - heightAt(vertex - vec2(1.0, 0.0))) / (2.0 * levelSpacing);
+            float dhdz = (heightAt(vertex + vec2(0.0, 1.0)) - heightAt(vertex - vec2(0.0, 1.0))) / (2.0 * levelSpacing);
+            vec3 scaledNormal = normalize(vec3(-dhdx * heightScale, 1.0, -dhdz * heightScale));
+
+            // Correct the normals based on model transformation (transpose inverse)
+            Normal = mat3(transpose(inverse(model))) * scaledNormal;
+
+            TexCoords = (xz - texCoordOrigin) * texCoordScale;
+
+            // Apply the transform matrix (MVP) to compute final position
+            gl_Position = transform * vec4(position, 1.0);
         }
+    )glsl";
 
+    const char *streamingShaderSource = R"glsl(
+        #version 330 core
+        out vec2 TexCoords;        // Pass texture coordinates to fragment shader
+        out vec3 FragPos;          // Pass fragment position to fragment shader
+        out vec3 Normal;           // Pass normal to fragment shader
+
+        uniform mat4 transform;    // MVP matrix (combined model, view, projection)
+        uniform mat4 model;        // Model matrix for normal transformation
+        uniform float heightScale; // Terrain amplitude; heights in the texture are at unit amplitude
+
+        uniform sampler2DArray tileHeights; // One R32F layer per tile cache slot, with a one-texel apron border
+        uniform int tileLayer;       // Slot of the current tile
+        uniform ivec2 tileFirst;     // Sample index of the tile's first vertex at its level
+        uniform float tileSpacing;   // Distance between the tile's samples
+        uniform float skirtDepth;    // How far skirt vertices hang below the tile edge
+        uniform int chunkPitch;      // Vertices per row of the shared patch index buffer
+        uniform vec2 texCoordOrigin; // Model-space x/z where the terrain textures start
+        uniform float texCoordScale; // Terrain texture coordinates per model-space unit
+
+        float heightAt(ivec2 vertex)
+        {
+            return texelFetch(tileHeights, ivec3(vertex + 1, tileLayer), 0).r; // Skip the apron border
+        }
 
+        void main()
+        {
+            // Indices past the patch are skirt vertices below the matching edge vertex
+            int patchVertices = chunkPitch * chunkPitch;
+            bool skirt = gl_VertexID >= patchVertices;
+            int id = skirt ? gl_VertexID - patchVertices : gl_VertexID;
+            ivec2 local = ivec2(id % chunkPitch, id / chunkPitch);
+
+            vec2 xz = vec2(tileFirst + local) * tileSpacing;
+            vec3 position = vec3(xz.x, heightAt(local) * heightScale - (skirt ? skirtDepth : 0.0), xz.y);
+
+            // Transform the vertex position
+            FragPos = vec3(model * vec4(position, 1.0));
+
+            // Central differences; the apron border supplies neighbours past the tile edges
+            float dhdx = (heightAt(local + ivec2(1, 0)) - heightAt(local - ivec2(1, 0))) / (2.0 * tileSpacing);
+            float dhdz = (heightAt(local + ivec2(0, 1)) - heightAt(local - ivec2(0, 1))) / (2.0 * tileSpacing);
+            vec3 scaledNormal = normalize(vec3(-dhdx * heightScale, 1.0, -dhdz * heightScale));
+
+            // Correct the normals based on model transformation (transpose inverse)
+            Normal = mat3(transpose(inverse(model))) * scaledNormal;
+
+            TexCoords = (xz - texCoordOrigin) * texCoordScale;
+
+            // Apply the transform matrix (MVP) to compute final position
+            gl_Position = transform * vec4(position, 1.0);
+        }
     )glsl";
 
+    const char *vertexShaderSource = heightTextureShaderSource;
+    if (renderMode == TerrainRenderMode::VertexBuffer)
+        vertexShaderSource = compactVertices ? compactVertexShaderSource : vertexBufferShaderSource;
+    else if (renderMode == TerrainRenderMode::Clipmap)
+        vertexShaderSource = clipmapShaderSource;
+    else if (renderMode == TerrainRenderMode::Streaming)
+        vertexShaderSource = streamingShaderSource;
+
     const char *fragmentShaderSource = R"glsl(
         
         #version 330 core
@@ -1452,49 +2892,697 @@ unsigned int loadTexture(char const *path)
     return textureID;
 }
 
+// Create the single-channel float texture holding the heights of a width x height grid plus a
+// one-texel apron border (texel = grid vertex + apron)
+unsigned int createHeightTexture(int width, int height)
+{
+    const int apron = TerrainChunks::apron;
+    unsigned int texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+
+    // Linear filtering interpolates the heights of morphing CDLOD vertices between grid
+    // vertices; texel centres (unmorphed vertices) still read the exact height
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, width + 2 * apron, height + 2 * apron, 0, GL_RED, GL_FLOAT, nullptr);
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return texture;
+}
+
+// Upload the heights of the given chunks into a texture from createHeightTexture. Each chunk
+// writes its block including its apron; where blocks overlap, neighbouring chunks hold
+// identical heights.
+void uploadHeightTexture(unsigned int texture, const TerrainChunks &chunks, const size_t *chunkIndices, size_t count)
+{
+    glBindTexture(GL_TEXTURE_2D, texture);
+
+    // Chunk heightfields are contiguous and float rows are always 4-byte aligned. Grid vertex
+    // (firstX - apron) lands on texel firstX.
+    for (size_t i = 0; i < count; ++i)
+    {
+        const TerrainChunks::Chunk &chunk = chunks.chunk(chunkIndices[i]);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, chunk.extent.firstX, chunk.extent.firstZ, chunk.heights.width(), chunk.heights.height(),
+                        GL_RED, GL_FLOAT, chunk.heights.data().data());
+    }
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+// Recentre the clipmap on `center` with the current terrain parameters and upload the texel
+// regions that changed. A new resolution or noise parameter regenerates every level; otherwise
+// the CPU work follows the camera's movement, not the size of the terrain.
+void updateClipmap(GeometryClipmap &clipmap, unsigned int &texture, const glm::vec3 &center)
+{
+    clipmap.configure(terrainGpuGrid.spacing, numOctaves, persistence, lacunarity, baseFrequency);
+    clipmap.update(center.x, center.z);
+
+    const int size = GeometryClipmap::textureSize;
+    if (texture == 0)
+    {
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+
+        // Read with texelFetch (the shader wraps and filters itself)
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_R32F, size, size, clipmap.levelCount(), 0, GL_RED, GL_FLOAT, nullptr);
+    }
+    else
+    {
+        glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+    }
+
+    // Regions are rectangles of a level's texel-order heights, so rows are `size` floats apart
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, size);
+    for (const GeometryClipmap::Region &region : clipmap.pendingRegions())
+    {
+        const float *first = clipmap.levelHeights(region.level) + (size_t)region.z * size + region.x;
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, region.x, region.z, region.level, region.width, region.height, 1, GL_RED, GL_FLOAT, first);
+    }
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    clipmap.clearPendingRegions();
+
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+// Upload the tiles that finished generating since the last frame into their slot's texture
+// layer, then select the tiles to draw around `center` and queue generation of missing ones.
+// Never waits for generation: tiles that are not ready are covered by coarser resident ones.
+void updateStreamingTiles(TerrainTileCache &cache, unsigned int &texture, const glm::vec3 &center, std::vector<TerrainTileCache::Draw> &draws)
+{
+    cache.configure(terrainGpuGrid.spacing, numOctaves, persistence, lacunarity, baseFrequency);
+
+    const int size = TerrainTileCache::tileSamples;
+    if (texture == 0)
+    {
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+
+        // Only read with texelFetch, but a complete texture still needs non-mipmap filtering
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_R32F, size, size, cache.capacity(), 0, GL_RED, GL_FLOAT, nullptr);
+    }
+    else
+    {
+        glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+    }
+
+    std::vector<int> completedSlots;
+    cache.collectCompleted(completedSlots);
+    for (int slot : completedSlots)
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, slot, size, size, 1, GL_RED, GL_FLOAT, cache.tileHeights(slot));
+
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    cache.select(center.x, center.z, streamingLevels, streamingRadius, streamingRefineRange, draws);
+}
+
 // Setup Buffers
-void setupBuffers(unsigned int &VAO, unsigned int &VBO, unsigned int &EBO, const std::vector<float> &vertices, const std::vector<float> &normals, const std::vector<unsigned int> &indices)
+// Upload the chunks with uploadPending set, and the index lists with indicesPending set. The VAO and EBO are created on the first call; GPU
+// terrain storage is only allocated when the grid layout changes, or for the spare that the next
+// upload at the same layout is written into (see TerrainUpload), so regenerating the terrain
+// never leaks GPU memory. In
+// TerrainRenderMode::HeightTexture and Cdlod only the heights go to the GPU and the VAO has no
+// vertex attributes, just the shared index buffer.
+//
+// With a budget, at most about budgetMilliseconds are spent per call, a slice of chunks at a
+// time; the upload is then continued by later calls until it returns true (terrainUpload.active
+// is set until then, and terrainChunks must stay unchanged). Without one, everything is uploaded.
+bool setupBuffers(unsigned int &VAO, unsigned int &VBO, unsigned int &EBO, TerrainChunks &chunks, const TerrainParameters &params,
+                  const std::vector<unsigned short> &indices, float budgetMilliseconds)
 {
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    glGenBuffers(1, &EBO);
+    if (VAO == 0)
+    {
+        glGenVertexArrays(1, &VAO);
+        glGenBuffers(1, &EBO);
+        uploadTerrainIndices(VAO, EBO, indices);
+        glBindVertexArray(0);
+    }
+    if (!terrainChunksDrawn())
+        return true;
 
-    glBindVertexArray(VAO);
+    const bool heightsOnGpu = terrainRenderMode == TerrainRenderMode::HeightTexture || terrainRenderMode == TerrainRenderMode::Cdlod;
+    const bool verticesOnGpu = terrainRenderMode == TerrainRenderMode::VertexBuffer;
+    TerrainUpload &upload = terrainUpload;
+    if (!upload.active)
+    {
+        upload.active = true;
+        upload.next = 0;
+        upload.failedUnmaps = 0;
+
+        // A new layout re-chunks the grid, so every chunk is pending
+        upload.newLayout = chunks.width() != terrainGpuGrid.width || chunks.height() != terrainGpuGrid.height ||
+                           chunks.spacing() != terrainGpuGrid.spacing || chunks.originX() != terrainGpuGrid.originX ||
+                           chunks.originZ() != terrainGpuGrid.originZ;
+
+        // Index lists change with the heights, or alone (a new decimation). The index buffer is
+        // not double buffered, so chunks written only to fill spare storage keep theirs.
+        bool heightsChanged = upload.newLayout;
+        upload.indexChunks.clear();
+        for (size_t i = 0; i < chunks.size(); ++i)
+        {
+            TerrainChunks::Chunk &chunk = chunks.chunk(i);
+            heightsChanged = heightsChanged || chunk.uploadPending;
+            if (chunk.uploadPending || chunk.indicesPending)
+                upload.indexChunks.push_back(i);
+            chunk.indicesPending = false;
+        }
+
+        // With the heights unchanged the drawn storage is current, so only the index lists are written
+        if (!heightsChanged)
+        {
+            upload.active = false;
+            if (verticesOnGpu && !upload.indexChunks.empty())
+            {
+                uploadDecimatedIndices(VAO, EBO, chunks, upload.indexChunks, indices);
+                glBindVertexArray(0);
+            }
+            return true;
+        }
+
+        // Write into a spare of this layout if there is one, adding the chunks it lacks (any other
+        // change since it was drawn is still marked uploadPending); otherwise allocate storage and
+        // write every chunk
+        upload.heightTexture = 0;
+        upload.vertexBuffer = 0;
+        glm::vec2 spareHeightRange(0.0f);
+        std::vector<size_t> lacking;
+        for (size_t k = 0; k < upload.spares.size(); ++k)
+        {
+            SpareTerrainStorage &spare = upload.spares[k];
+            if (spare.width == chunks.width() && spare.height == chunks.height() && spare.spacing == chunks.spacing() &&
+                spare.originX == chunks.originX() && spare.originZ == chunks.originZ())
+            {
+                upload.heightTexture = spare.heightTexture;
+                upload.vertexBuffer = spare.vertexBuffer;
+                spareHeightRange = spare.compactHeightRange;
+                lacking.swap(spare.lacking);
+                upload.spares.erase(upload.spares.begin() + k);
+                break;
+            }
+        }
+        const bool spare = upload.heightTexture != 0 || upload.vertexBuffer != 0;
+        if (heightsOnGpu && !spare)
+        {
+            upload.heightTexture = createHeightTexture(chunks.width(), chunks.height());
+        }
+        else if (verticesOnGpu && !spare)
+        {
+            // Every chunk owns a full chunkVertices x chunkVertices slot, in chunk order
+            const size_t vertexBytes = compactVertexFormat ? sizeof(CompactTerrainVertex) : terrainVertexFloats * sizeof(float);
+            glGenBuffers(1, &upload.vertexBuffer);
+            glBindBuffer(GL_ARRAY_BUFFER, upload.vertexBuffer);
+            glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(chunks.size() * TerrainChunks::chunkVertices * TerrainChunks::chunkVertices * vertexBytes),
+                         nullptr, GL_STATIC_DRAW);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        }
+
+        // Compact vertices keep the spare's quantization range while it covers the grid; a range
+        // that has to change (or new storage) requantizes every chunk
+        glm::vec2 heightRange(FLT_MAX, -FLT_MAX);
+        for (size_t i = 0; i < chunks.size(); ++i)
+        {
+            heightRange.x = std::min(heightRange.x, chunks.chunk(i).minHeight);
+            heightRange.y = std::max(heightRange.y, chunks.chunk(i).maxHeight);
+        }
+        const bool requantize = verticesOnGpu && compactVertexFormat &&
+                                (!spare || heightRange.x < spareHeightRange.x || heightRange.y > spareHeightRange.y);
+        upload.grid.compactHeightRange = requantize ? heightRange : spareHeightRange;
+
+        upload.chunks.clear();
+        for (size_t i = 0, p = 0; i < chunks.size(); ++i)
+        {
+            while (p < lacking.size() && lacking[p] < i)
+                ++p;
+            if (!spare || requantize || chunks.chunk(i).uploadPending || (p < lacking.size() && lacking[p] == i))
+                upload.chunks.push_back(i);
+        }
+
+        // Chunks that are not written keep the height ranges drawn now
+        upload.grid.width = chunks.width();
+        upload.grid.height = chunks.height();
+        upload.grid.spacing = chunks.spacing();
+        upload.grid.originX = chunks.originX();
+        upload.grid.originZ = chunks.originZ();
+        upload.grid.chunks.resize(chunks.size());
+        for (size_t i = 0; i < chunks.size(); ++i)
+            upload.grid.chunks[i] = chunks.chunk(i).extent;
+        if (upload.newLayout)
+            upload.grid.chunkHeights.resize(chunks.size());
+        else
+            upload.grid.chunkHeights = terrainGpuGrid.chunkHeights;
+    }
+
+    // Slices are large enough to keep the pool busy while vertices are written
+    const size_t sliceChunks = 4 * threadPool.size();
+    TerrainGpuGrid &grid = upload.grid;
+    const auto start = std::chrono::steady_clock::now();
+    while (upload.next < upload.chunks.size())
+    {
+        const double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (budgetMilliseconds > 0.0f && elapsed >= budgetMilliseconds)
+            break;
+
+        const size_t *slice = upload.chunks.data() + upload.next;
+        const size_t count = std::min(sliceChunks, upload.chunks.size() - upload.next);
+        if (heightsOnGpu)
+        {
+            uploadHeightTexture(upload.heightTexture, chunks, slice, count);
+        }
+        else if (verticesOnGpu && !writeChunkVertexSlots(upload.vertexBuffer, chunks, params, grid.compactHeightRange, slice, count))
+        {
+            // A failed mapping, or (rare) loss of the whole buffer's contents: rewrite every chunk, once
+            if (++upload.failedUnmaps == 1)
+            {
+                upload.chunks.resize(chunks.size());
+                for (size_t i = 0; i < chunks.size(); ++i)
+                    upload.chunks[i] = i;
+                upload.next = 0;
+                continue;
+            }
+            if (upload.failedUnmaps == 2)
+                std::cerr << "Failed to upload the terrain vertex buffer" << std::endl;
+        }
+
+        // Bounds for culling follow the chunks' heights
+        for (size_t i = 0; i < count; ++i)
+        {
+            TerrainChunks::Chunk &chunk = chunks.chunk(slice[i]);
+            grid.chunkHeights[slice[i]] = glm::vec2(chunk.minHeight, chunk.maxHeight);
+            chunk.uploadPending = false;
+        }
+        upload.next += count;
+    }
+    if (upload.next < upload.chunks.size())
+        return false;
 
-    // Create an interleaved vertex buffer (positions + normals + texture coordinates)
-    std::vector<float> interleavedData;
-    for (size_t i = 0; i < vertices.size() / 5; ++i)
+    // Swap in the written storage, and record what is now on the GPU for drawing. The replaced
+    // storage becomes a spare; spares unrelated to the new layout (another resolution) are freed.
+    if (heightTexture != 0 || VBO != 0)
+    {
+        const TerrainGpuGrid &drawn = terrainGpuGrid;
+        for (size_t k = 0; k < upload.spares.size(); ++k)
+        {
+            // One spare per layout is enough
+            SpareTerrainStorage &spare = upload.spares[k];
+            if (spare.width == drawn.width && spare.height == drawn.height && spare.spacing == drawn.spacing &&
+                spare.originX == drawn.originX && spare.originZ == drawn.originZ)
+            {
+                glDeleteTextures(1, &spare.heightTexture);
+                glDeleteBuffers(1, &spare.vertexBuffer);
+                upload.spares.erase(upload.spares.begin() + k);
+                break;
+            }
+        }
+        upload.spares.push_back({drawn.width, drawn.height, drawn.spacing, drawn.originX, drawn.originZ, heightTexture, VBO,
+                                 drawn.compactHeightRange, upload.newLayout ? std::vector<size_t>() : upload.chunks});
+    }
+    heightTexture = upload.heightTexture;
+    VBO = upload.vertexBuffer;
+    upload.heightTexture = 0;
+    upload.vertexBuffer = 0;
+    if (verticesOnGpu)
+        bindTerrainVertexAttributes(VAO, VBO);
+    for (size_t k = upload.spares.size(); k-- > 0;)
+    {
+        const SpareTerrainStorage &spare = upload.spares[k];
+        const TerrainGpuGrid &grid = upload.grid;
+        if (!isRefinementLevel(spare.width, spare.height, spare.spacing, grid.width, grid.height, grid.spacing) &&
+            !isRefinementLevel(grid.width, grid.height, grid.spacing, spare.width, spare.height, spare.spacing))
+        {
+            glDeleteTextures(1, &spare.heightTexture);
+            glDeleteBuffers(1, &spare.vertexBuffer);
+            upload.spares.erase(upload.spares.begin() + k);
+        }
+    }
+    std::swap(terrainGpuGrid.width, upload.grid.width);
+    std::swap(terrainGpuGrid.height, upload.grid.height);
+    std::swap(terrainGpuGrid.spacing, upload.grid.spacing);
+    std::swap(terrainGpuGrid.originX, upload.grid.originX);
+    std::swap(terrainGpuGrid.originZ, upload.grid.originZ);
+    std::swap(terrainGpuGrid.compactHeightRange, upload.grid.compactHeightRange);
+    terrainGpuGrid.chunks.swap(upload.grid.chunks);
+    terrainGpuGrid.chunkHeights.swap(upload.grid.chunkHeights);
+
+    if (heightsOnGpu)
+    {
+        // Node height ranges follow the chunks' (the tree is cheap to rebuild)
+        cdlodQuadtree.build(chunks);
+        cdlodQuadtree.setRanges(TerrainChunks::chunkQuads * chunks.spacing() * cdlodLeafRangeScale, cdlodMorphStartRatio);
+    }
+    else if (verticesOnGpu)
     {
-        interleavedData.push_back(vertices[5 * i]);     // x
-        interleavedData.push_back(vertices[5 * i + 1]); // y
-        interleavedData.push_back(vertices[5 * i + 2]); // z
-        interleavedData.push_back(vertices[5 * i + 3]); // u (texture coordinate)
-        interleavedData.push_back(vertices[5 * i + 4]); // v (texture coordinate)
-        interleavedData.push_back(normals[3 * i]);      // normal x
-        interleavedData.push_back(normals[3 * i + 1]);  // normal y
-        interleavedData.push_back(normals[3 * i + 2]);  // normal z
+        // Decimated chunks draw their own index lists, stored after the shared patch indices
+        uploadDecimatedIndices(VAO, EBO, chunks, upload.indexChunks, indices);
+        glBindVertexArray(0);
     }
 
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, interleavedData.size() * sizeof(float), &interleavedData[0], GL_STATIC_DRAW);
+    upload.active = false;
+    return true;
+}
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+// Whether the coarse grid is a progressive refinement level of the fine one (or the same grid):
+// every step-th sample of it, for some power of two step, as generateAdvancedTerrain lays it out
+bool isRefinementLevel(int coarseWidth, int coarseHeight, float coarseSpacing, int fineWidth, int fineHeight, float fineSpacing)
+{
+    for (int step = 1; step < fineWidth || step < fineHeight; step *= 2)
+    {
+        if (coarseSpacing == fineSpacing * step && coarseWidth == (fineWidth - 1 + step - 1) / step + 1 &&
+            coarseHeight == (fineHeight - 1 + step - 1) / step + 1)
+            return true;
+    }
+    return false;
+}
 
-    // Set vertex attribute pointers
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *)0); // Position
-    glEnableVertexAttribArray(0);
+// Write the vertices of the given chunks (in increasing order) into their slots of `buffer`, in
+// the layout selected by compactVertexFormat. Returns false if the buffer could not be mapped or
+// glUnmapBuffer reports that its contents were lost.
+bool writeChunkVertexSlots(unsigned int buffer, TerrainChunks &chunks, const TerrainParameters &params, const glm::vec2 &heightRange,
+                           const size_t *chunkIndices, size_t count)
+{
+    const size_t vertexBytes = compactVertexFormat ? sizeof(CompactTerrainVertex) : terrainVertexFloats * sizeof(float);
+    const GLsizeiptr chunkBytes = (GLsizeiptr)((size_t)TerrainChunks::chunkVertices * TerrainChunks::chunkVertices * vertexBytes);
+
+    PerlinNoise::Octaves octaves;
+    if (terrainNormalMode == NormalMode::Analytic)
+        octaves = PerlinNoise::makeOctaves(params.numOctaves, params.persistence, params.lacunarity, params.baseFrequency, 1.0f);
+
+    // Map the slots from the first chunk to the last. When they are all being written the range
+    // can be invalidated, which lets the driver hand out fresh storage instead of waiting on
+    // in-flight draws; otherwise only the written slots are flushed.
+    const size_t firstSlot = chunkIndices[0];
+    const size_t slotCount = chunkIndices[count - 1] - firstSlot + 1;
+    const bool contiguous = (slotCount == count);
+    GLbitfield access = GL_MAP_WRITE_BIT | (contiguous ? GL_MAP_INVALIDATE_RANGE_BIT : GL_MAP_FLUSH_EXPLICIT_BIT);
+
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    char *mapped = static_cast<char *>(glMapBufferRange(GL_ARRAY_BUFFER, (GLintptr)firstSlot * chunkBytes, (GLsizeiptr)slotCount * chunkBytes, access));
+    if (!mapped)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        return false;
+    }
 
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *)(3 * sizeof(float))); // TexCoords
-    glEnableVertexAttribArray(1);
+    threadPool.parallelFor(0, (int)count, 1, [&](int first, int last) {
+        for (int i = first; i < last; ++i)
+        {
+            const TerrainChunks::Chunk &chunk = chunks.chunk(chunkIndices[i]);
+            char *slot = mapped + (chunkIndices[i] - firstSlot) * chunkBytes;
+            if (compactVertexFormat)
+                writeCompactChunkVertices(chunks, chunk, octaves, heightRange, reinterpret_cast<CompactTerrainVertex *>(slot));
+            else
+                writeChunkVertices(chunks, chunk, octaves, reinterpret_cast<float *>(slot));
+        }
+    });
 
-    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *)(5 * sizeof(float))); // Normals
-    glEnableVertexAttribArray(2);
+    if (!contiguous)
+    {
+        for (size_t i = 0; i < count; ++i)
+            glFlushMappedBufferRange(GL_ARRAY_BUFFER, (GLintptr)(chunkIndices[i] - firstSlot) * chunkBytes, chunkBytes);
+    }
 
+    const bool written = glUnmapBuffer(GL_ARRAY_BUFFER) == GL_TRUE;
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return written;
+}
+
+// Point the VAO's vertex attributes at `buffer` (TerrainRenderMode::VertexBuffer)
+void bindTerrainVertexAttributes(unsigned int VAO, unsigned int buffer)
+{
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    if (compactVertexFormat)
+    {
+        glVertexAttribIPointer(0, 1, GL_UNSIGNED_SHORT, sizeof(CompactTerrainVertex), (void *)offsetof(CompactTerrainVertex, height));
+        glEnableVertexAttribArray(0);
+
+        glVertexAttribIPointer(2, 2, GL_BYTE, sizeof(CompactTerrainVertex), (void *)offsetof(CompactTerrainVertex, normal));
+        glEnableVertexAttribArray(2);
+    }
+    else
+    {
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *)0); // Position
+        glEnableVertexAttribArray(0);
+
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *)(3 * sizeof(float))); // TexCoords
+        glEnableVertexAttribArray(1);
+
+        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *)(5 * sizeof(float))); // Normals
+        glEnableVertexAttribArray(2);
+    }
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindVertexArray(0);
 }
 
+// Fill the terrain EBO with the shared patch indices followed by terrainGpuGrid.decimatedIndices.
+// The EBO binding is VAO state, so this leaves `VAO` bound.
+void uploadTerrainIndices(unsigned int VAO, unsigned int EBO, const std::vector<unsigned short> &indices)
+{
+    const std::vector<unsigned short> &decimated = terrainGpuGrid.decimatedIndices;
+    const GLsizeiptr sharedBytes = (GLsizeiptr)(indices.size() * sizeof(unsigned short));
+    const GLsizeiptr decimatedBytes = (GLsizeiptr)(decimated.size() * sizeof(unsigned short));
+
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sharedBytes + decimatedBytes, nullptr, GL_STATIC_DRAW);
+    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, sharedBytes, indices.data());
+    if (decimatedBytes > 0)
+        glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, sharedBytes, decimatedBytes, decimated.data());
+    terrainGpuGrid.decimatedIndicesOnGpu = decimated.size();
+}
+
+// Store the decimated index lists of the `changed` chunks (in chunk order) in
+// terrainGpuGrid.decimatedIndices and the EBO. A chunk keeps its range while its new list fits,
+// and only those ranges are written; a list that outgrows its range moves to the end with some
+// headroom. The EBO is only filled again when the lists outgrow it, or once more than half of
+// decimatedIndices is left behind by moved or dropped lists (it is then compacted). Leaves `VAO`
+// bound.
+void uploadDecimatedIndices(unsigned int VAO, unsigned int EBO, const TerrainChunks &chunks, const std::vector<size_t> &changed,
+                            const std::vector<unsigned short> &indices)
+{
+    TerrainGpuGrid &grid = terrainGpuGrid;
+    std::vector<unsigned short> &decimated = grid.decimatedIndices;
+    std::vector<glm::ivec3> &ranges = grid.chunkIndexRanges;
+    if (ranges.size() != chunks.size())
+    {
+        // A new layout: every chunk is in `changed`
+        ranges.assign(chunks.size(), glm::ivec3(0));
+        decimated.clear();
+        grid.decimatedWaste = 0;
+    }
+
+    for (size_t i : changed)
+    {
+        const std::vector<unsigned short> &chunkIndices = chunks.chunk(i).decimatedIndices;
+        glm::ivec3 &range = ranges[i];
+        if (chunkIndices.empty() || (int)chunkIndices.size() > range.z)
+        {
+            grid.decimatedWaste += range.z;
+            range = glm::ivec3(0);
+        }
+        if (!chunkIndices.empty() && range.z == 0)
+        {
+            range.x = (int)decimated.size();
+            range.z = (int)(chunkIndices.size() + chunkIndices.size() / 8);
+            decimated.resize(decimated.size() + range.z);
+        }
+        range.y = (int)chunkIndices.size();
+        std::copy(chunkIndices.begin(), chunkIndices.end(), decimated.begin() + range.x);
+    }
+
+    if (grid.decimatedWaste == decimated.size())
+    {
+        // Nothing is decimated any more
+        decimated.clear();
+        grid.decimatedWaste = 0;
+    }
+    else if (grid.decimatedWaste > decimated.size() / 2)
+    {
+        std::vector<unsigned short> compacted;
+        compacted.reserve(decimated.size() - grid.decimatedWaste);
+        for (glm::ivec3 &range : ranges)
+        {
+            if (range.z == 0)
+                continue;
+            compacted.insert(compacted.end(), decimated.begin() + range.x, decimated.begin() + range.x + range.z);
+            range.x = (int)(compacted.size() - range.z);
+        }
+        decimated.swap(compacted);
+        grid.decimatedWaste = 0;
+        uploadTerrainIndices(VAO, EBO, indices);
+        return;
+    }
+    if (decimated.size() > grid.decimatedIndicesOnGpu)
+    {
+        uploadTerrainIndices(VAO, EBO, indices);
+        return;
+    }
+
+    // Write the changed ranges, each run of adjacent ones (chunks are laid out in order) in one call
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    const size_t sharedCount = indices.size();
+    size_t first = 0, end = 0;
+    auto write = [&]() {
+        if (end > first)
+            glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, (GLintptr)((sharedCount + first) * sizeof(unsigned short)),
+                            (GLsizeiptr)((end - first) * sizeof(unsigned short)), decimated.data() + first);
+    };
+    for (size_t i : changed)
+    {
+        const glm::ivec3 &range = ranges[i];
+        if (range.y == 0)
+            continue;
+        if ((size_t)range.x != end)
+        {
+            write();
+            first = range.x;
+        }
+        end = range.x + range.z;
+    }
+    write();
+}
+
+// Start timing this frame's terrain draws
+void beginTerrainDrawTiming(TerrainDrawTimer &timer)
+{
+    timer.running = false;
+    if (!terrainDrawTiming)
+        return;
+    if (timer.queries[0] == 0)
+        glGenQueries(2, timer.queries);
+
+    // The query used two frames ago is usually finished by now; if not, this frame goes untimed
+    // rather than wait for it
+    const int slot = timer.frame & 1;
+    if (timer.pending[slot])
+    {
+        GLint available = 0;
+        glGetQueryObjectiv(timer.queries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            return;
+
+        GLuint64 nanoseconds = 0;
+        glGetQueryObjectui64v(timer.queries[slot], GL_QUERY_RESULT, &nanoseconds);
+        timer.pending[slot] = false;
+        timer.totalMilliseconds += nanoseconds * 1e-6;
+        if (++timer.samples == TerrainDrawTimer::frames)
+        {
+            timer.averageMilliseconds = timer.totalMilliseconds / timer.samples;
+            timer.samples = 0;
+            timer.totalMilliseconds = 0.0;
+        }
+    }
+    glBeginQuery(GL_TIME_ELAPSED, timer.queries[slot]);
+    timer.running = true;
+}
+
+void endTerrainDrawTiming(TerrainDrawTimer &timer)
+{
+    if (!timer.running)
+        return;
+    glEndQuery(GL_TIME_ELAPSED);
+    timer.pending[timer.frame & 1] = true;
+    ++timer.frame;
+}
+
+// Drop the samples so far, e.g. when what is being timed changes
+void resetTerrainDrawTiming(TerrainDrawTimer &timer)
+{
+    timer.samples = 0;
+    timer.totalMilliseconds = 0.0;
+    timer.averageMilliseconds = 0.0;
+}
+
+// Add the model-space bounding box of every chunk of `grid` to the culler, in chunk order
+void addChunkBounds(FrustumCuller &culler, const TerrainGpuGrid &grid, float heightScale)
+{
+    culler.reserve(grid.chunks.size());
+    for (size_t i = 0; i < grid.chunks.size(); ++i)
+    {
+        const TerrainChunks::Extent &extent = grid.chunks[i];
+        const glm::vec2 &heights = grid.chunkHeights[i];
+        glm::vec3 boxMin(grid.originX + extent.firstX * grid.spacing, std::min(heights.x * heightScale, heights.y * heightScale),
+                         grid.originZ + extent.firstZ * grid.spacing);
+        glm::vec3 boxMax(grid.originX + (extent.firstX + extent.quadsX) * grid.spacing, std::max(heights.x * heightScale, heights.y * heightScale),
+                         grid.originZ + (extent.firstZ + extent.quadsZ) * grid.spacing);
+        culler.add(boxMin, boxMax);
+    }
+}
+
+// Horizon-cull the visible chunks of terrainGpuGrid (indices into its chunk list)
+void cullHiddenChunks(const glm::mat4 &mvp, const glm::vec3 &eye, float heightScale, std::vector<int> &visible)
+{
+    const int chunksX = (terrainGpuGrid.width - 1 + TerrainChunks::chunkQuads - 1) / TerrainChunks::chunkQuads;
+    horizonDraws.clear();
+    for (int i : visible)
+    {
+        const TerrainChunks::Extent &extent = terrainGpuGrid.chunks[i];
+        const glm::vec2 &heights = terrainGpuGrid.chunkHeights[i];
+        HorizonDraw draw;
+        draw.boxMin = glm::vec3(terrainGpuGrid.originX + extent.firstX * terrainGpuGrid.spacing, std::min(heights.x * heightScale, heights.y * heightScale),
+                                terrainGpuGrid.originZ + extent.firstZ * terrainGpuGrid.spacing);
+        draw.boxMax = glm::vec3(terrainGpuGrid.originX + (extent.firstX + extent.quadsX) * terrainGpuGrid.spacing, std::max(heights.x * heightScale, heights.y * heightScale),
+                                terrainGpuGrid.originZ + (extent.firstZ + extent.quadsZ) * terrainGpuGrid.spacing);
+        draw.chunks = glm::ivec4(i % chunksX, i / chunksX, i % chunksX, i / chunksX);
+        draw.fullResolution = true;
+        horizonDraws.push_back(draw);
+    }
+    cullHiddenDraws(horizonCuller, mvp, eye, terrainGpuGrid, heightScale, horizonDraws, visible);
+}
+
+// Drop from `visible` the draws hidden behind nearer terrain; draws[i] describes draw visible[i].
+// The occluder of a full-resolution draw is its chunk's footprint from the lowest terrain height
+// up to the chunk's lowest height, which lies inside the terrain. That only holds with the camera
+// above the surface, so nothing is culled while it is below the highest point of its own chunk.
+void cullHiddenDraws(HorizonCuller &culler, const glm::mat4 &mvp, const glm::vec3 &eye, const TerrainGpuGrid &grid, float heightScale,
+                     const std::vector<HorizonDraw> &draws, std::vector<int> &visible)
+{
+    if (grid.chunks.empty())
+        return;
+
+    const int chunksX = (grid.width - 1 + TerrainChunks::chunkQuads - 1) / TerrainChunks::chunkQuads;
+    const int chunksZ = (grid.height - 1 + TerrainChunks::chunkQuads - 1) / TerrainChunks::chunkQuads;
+    const float chunkSize = TerrainChunks::chunkQuads * grid.spacing;
+    const glm::ivec2 eyeChunk((int)std::floor((eye.x - grid.originX) / chunkSize), (int)std::floor((eye.z - grid.originZ) / chunkSize));
+
+    // The occluder boxes are only solid for an eye above the surface. From beside the grid, even
+    // high above it, the eye can look in through the open edge under an edge chunk and then see
+    // the underside of a lower one (there is no back-face culling), so nothing is culled then.
+    if (eyeChunk.x < 0 || eyeChunk.x >= chunksX || eyeChunk.y < 0 || eyeChunk.y >= chunksZ)
+        return;
+    const glm::vec2 &eyeHeights = grid.chunkHeights[(size_t)eyeChunk.y * chunksX + eyeChunk.x];
+    if (eye.y < std::max(eyeHeights.x * heightScale, eyeHeights.y * heightScale))
+        return;
+
+    float bottom = FLT_MAX;
+    for (const glm::vec2 &heights : grid.chunkHeights)
+        bottom = std::min(bottom, std::min(heights.x * heightScale, heights.y * heightScale));
+
+    std::vector<HorizonCuller::Occluder> occluders;
+    std::vector<HorizonCuller::Candidate> candidates;
+    for (const HorizonDraw &draw : draws)
+    {
+        // Manhattan distance in chunks from the camera's chunk to the draw's nearest chunk
+        int ring = std::max(0, std::max(draw.chunks.x - eyeChunk.x, eyeChunk.x - draw.chunks.z)) +
+                   std::max(0, std::max(draw.chunks.y - eyeChunk.y, eyeChunk.y - draw.chunks.w));
+        candidates.push_back({draw.boxMin, draw.boxMax, ring});
+
+        if (draw.fullResolution)
+        {
+            const glm::vec2 &heights = grid.chunkHeights[(size_t)draw.chunks.y * chunksX + draw.chunks.x];
+            glm::vec3 boxMax(draw.boxMax.x, std::min(heights.x * heightScale, heights.y * heightScale), draw.boxMax.z);
+            occluders.push_back({glm::vec3(draw.boxMin.x, bottom, draw.boxMin.z), boxMax, ring});
+        }
+    }
+    culler.cull(mvp, occluders, candidates, visible);
+}
+
 void setupWaterBuffers(unsigned int &waterVAO, unsigned int &waterVBO, const std::vector<float> &waterVertices)
 {
     glGenVertexArrays(1, &waterVAO);